@@ -0,0 +1,173 @@
+/*
+ *
+ * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
+ * Synthetic .v2 corpus generator shared by the benchmarks and gen_corpus.
+ * Copyright (c) 2024-2025 Cyril John Magayaga
+ *
+ */
+#ifndef V2_BENCH_CORPUS_H
+#define V2_BENCH_CORPUS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// The shape of a generated corpus
+typedef struct CorpusShape {
+    size_t bytes;              // stop once the file is at least this long
+    int depth;                 // deepest block nesting
+    double duplicateRatio;     // share of keys that repeat an earlier sibling's key
+    size_t valueLength;        // average length of a string value
+    uint64_t seed;
+} CorpusShape;
+
+typedef struct CorpusGenerator {
+    const CorpusShape *shape;
+    FILE *file;
+    size_t written;
+    uint64_t state;
+} CorpusGenerator;
+
+// xorshift64: fast, repeatable for a given seed
+static uint64_t corpusRandom(CorpusGenerator *generator) {
+    generator->state ^= generator->state << 13;
+    generator->state ^= generator->state >> 7;
+    generator->state ^= generator->state << 17;
+    return generator->state;
+}
+
+// A uniform number in [0, 1)
+static double corpusChance(CorpusGenerator *generator) {
+    return (double)(corpusRandom(generator) >> 11) / 9007199254740992.0;
+}
+
+static void corpusPrint(CorpusGenerator *generator, const char *text, size_t length) {
+    fwrite(text, 1, length, generator->file);
+    generator->written += length;
+}
+
+static void corpusIndent(CorpusGenerator *generator, int level) {
+    static const char spaces[] = "                                                                ";
+    size_t width = (size_t)level * 3;
+    if (width > sizeof(spaces) - 1) width = sizeof(spaces) - 1;
+    corpusPrint(generator, spaces, width);
+}
+
+// Write a value: mostly quoted strings around the requested length, with
+// some numbers, booleans and backslashes that JSON has to escape
+static void corpusValue(CorpusGenerator *generator) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_./:";
+    char text[1024];
+    size_t length = 0;
+    uint64_t kind = corpusRandom(generator) % 10;
+
+    if (kind == 0) {
+        length = (size_t)snprintf(text, sizeof(text), " %llu", (unsigned long long)(corpusRandom(generator) % 100000));
+    }
+
+    else if (kind == 1) {
+        length = (size_t)snprintf(text, sizeof(text), " %s", corpusRandom(generator) & 1 ? "true" : "false");
+    }
+
+    else {
+        size_t target = generator->shape->valueLength;
+        if (target > 0) target = target / 2 + (size_t)(corpusRandom(generator) % (target + 1));
+        if (target > sizeof(text) - 8) target = sizeof(text) - 8;
+        text[length++] = ' ';
+        text[length++] = '"';
+        for (size_t i = 0; i < target; i++) {
+            uint64_t pick = corpusRandom(generator);
+            // About one character in 64 is a backslash
+            if (pick % 64 == 0) text[length++] = '\\';
+            else text[length++] = alphabet[(pick >> 8) % (sizeof(alphabet) - 1)];
+        }
+        text[length++] = '"';
+    }
+    corpusPrint(generator, text, length);
+}
+
+// Write the entries of one block at `level`, returning when the block is full
+// or the corpus is long enough
+static void corpusBlock(CorpusGenerator *generator, int level) {
+    char line[64];
+    unsigned keys = 0;
+    unsigned entries = 4 + (unsigned)(corpusRandom(generator) % 12);
+    if (level == 0) entries = UINT32_MAX;
+
+    for (unsigned i = 0; i < entries && generator->written < generator->shape->bytes; i++) {
+        // Either a new key, or one this block already used
+        unsigned key = keys;
+        if (keys > 0 && corpusChance(generator) < generator->shape->duplicateRatio) {
+            key = (unsigned)(corpusRandom(generator) % keys);
+        }
+
+        else {
+            keys++;
+        }
+
+        corpusIndent(generator, level);
+        int opensBlock = level < generator->shape->depth && corpusRandom(generator) % 4 == 0;
+        if (opensBlock) {
+            size_t length = (size_t)snprintf(line, sizeof(line), "key%u {\n", key);
+            corpusPrint(generator, line, length);
+            corpusBlock(generator, level + 1);
+            corpusIndent(generator, level);
+            corpusPrint(generator, "}\n", 2);
+        }
+
+        else {
+            size_t length = (size_t)snprintf(line, sizeof(line), "key%u =", key);
+            corpusPrint(generator, line, length);
+            corpusValue(generator);
+            corpusPrint(generator, "\n", 1);
+        }
+    }
+}
+
+// Function to write a corpus of the given shape; returns the bytes written
+static size_t generateCorpus(FILE *file, const CorpusShape *shape) {
+    CorpusGenerator generator = { shape, file, 0, shape->seed ? shape->seed : 88172645463325252ULL };
+    corpusBlock(&generator, 0);
+    return generator.written;
+}
+
+// The in-memory corpora the throughput benches share: flat, nested, and
+// heavy on repeated keys
+#define BENCH_CORPUS_COUNT 3
+
+static const char *const benchCorpusNames[BENCH_CORPUS_COUNT] = { "flat", "nested", "duplicates" };
+
+static const CorpusShape benchCorpusShapes[BENCH_CORPUS_COUNT] = {
+    { 16 * 1024 * 1024, 0, 0.0,  24, 1 },
+    { 16 * 1024 * 1024, 6, 0.05, 24, 2 },
+    { 16 * 1024 * 1024, 2, 0.5,  24, 3 },
+};
+
+// Function to generate shared corpus n into memory; returns the text (for
+// the caller to free) and sets its length, or NULL on failure
+static inline char *generateCorpusText(size_t n, size_t *length) {
+    char *text = NULL;
+    FILE *file = open_memstream(&text, length);
+    if (!file) return NULL;
+    generateCorpus(file, &benchCorpusShapes[n]);
+    fclose(file);
+    return text;
+}
+
+static inline double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Sink that drops the output; the emitters still do all of their work
+static inline int discardSink(void *context, const char *data, size_t length) {
+    (void)context;
+    (void)data;
+    (void)length;
+    return 1;
+}
+
+#endif
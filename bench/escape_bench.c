@@ -0,0 +1,164 @@
+/*
+ *
+ * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
+ * Microbenchmark for JSON string escaping.
+ * Copyright (c) 2024-2025 Cyril John Magayaga
+ *
+ */
+#define V2_NO_MAIN
+#include "../src/v2.c"
+
+#include <time.h>
+
+// The original byte-at-a-time escaper, kept here as the baseline
+static void escapeJSONStringSwitch(const char *input, char *output, size_t outSize) {
+    size_t outIndex = 0;
+
+    while (*input && outIndex < outSize - 1) {
+        switch (*input) {
+            case '"':
+                if (outIndex + 2 < outSize) {
+                    output[outIndex++] = '\\';
+                    output[outIndex++] = '"';
+                }
+                break;
+            case '\\':
+                if (outIndex + 2 < outSize) {
+                    output[outIndex++] = '\\';
+                    output[outIndex++] = '\\';
+                }
+                break;
+            case '\b':
+                if (outIndex + 2 < outSize) {
+                    output[outIndex++] = '\\';
+                    output[outIndex++] = 'b';
+                }
+                break;
+            case '\f':
+                if (outIndex + 2 < outSize) {
+                    output[outIndex++] = '\\';
+                    output[outIndex++] = 'f';
+                }
+                break;
+            case '\n':
+                if (outIndex + 2 < outSize) {
+                    output[outIndex++] = '\\';
+                    output[outIndex++] = 'n';
+                }
+                break;
+            case '\r':
+                if (outIndex + 2 < outSize) {
+                    output[outIndex++] = '\\';
+                    output[outIndex++] = 'r';
+                }
+                break;
+            case '\t':
+                if (outIndex + 2 < outSize) {
+                    output[outIndex++] = '\\';
+                    output[outIndex++] = 't';
+                }
+                break;
+            default:
+                output[outIndex++] = *input;
+                break;
+        }
+        input++;
+    }
+    output[outIndex] = '\0';
+}
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Build a printable ASCII string with one escapable byte every `escapeEvery` bytes (0 = none)
+static char *makeInput(size_t length, size_t escapeEvery) {
+    char *str = (char *)malloc(length + 1);
+    for (size_t i = 0; i < length; i++) {
+        str[i] = (char)('a' + (i * 7) % 26);
+        if (escapeEvery && i % escapeEvery == escapeEvery - 1) {
+            str[i] = (i / escapeEvery) % 2 ? '"' : '\n';
+        }
+    }
+    str[length] = '\0';
+    return str;
+}
+
+typedef void (*EscapeFunction)(const char *input, char *output, size_t outSize);
+
+static double measure(EscapeFunction escape, const char *input, size_t length, char *output, size_t outSize) {
+    size_t iterations = (64u * 1024 * 1024) / (length + 1) + 1;
+    volatile char sink = 0;
+    double start = nowSeconds();
+    for (size_t i = 0; i < iterations; i++) {
+        escape(input, output, outSize);
+        sink ^= output[0];
+    }
+    double elapsed = nowSeconds() - start;
+    (void)sink;
+    return (double)(iterations * length) / elapsed / (1024.0 * 1024.0);
+}
+
+int main(void) {
+    static const size_t lengths[] = { 16, 64, 256, 4096, 65536 };
+    static const size_t escapeEvery[] = { 0, 64, 8 };
+
+    struct {
+        const char *name;
+        size_t (*scan)(const char *str, size_t length);
+    } kernels[4];
+    int kernelCount = 0;
+    kernels[kernelCount].name = "scalar";
+    kernels[kernelCount++].scan = jsonSafePrefixScalar;
+#ifdef V2_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        kernels[kernelCount].name = "sse2";
+        kernels[kernelCount++].scan = jsonSafePrefixSSE2;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        kernels[kernelCount].name = "avx2";
+        kernels[kernelCount++].scan = jsonSafePrefixAVX2;
+    }
+#endif
+
+    printf("%-8s %-10s %12s", "length", "escapes", "switch MB/s");
+    for (int k = 0; k < kernelCount; k++) printf(" %10s MB/s", kernels[k].name);
+    printf("\n");
+
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        for (size_t e = 0; e < sizeof(escapeEvery) / sizeof(escapeEvery[0]); e++) {
+            size_t length = lengths[l];
+            char *input = makeInput(length, escapeEvery[e]);
+            size_t outSize = length * 6 + 1;
+            char *expected = (char *)malloc(outSize);
+            char *output = (char *)malloc(outSize);
+
+            char label[32];
+            if (escapeEvery[e]) snprintf(label, sizeof(label), "1/%zu", escapeEvery[e]);
+            else snprintf(label, sizeof(label), "none");
+            printf("%-8zu %-10s %12.0f", length, label,
+                   measure(escapeJSONStringSwitch, input, length, output, outSize));
+
+            escapeJSONStringSwitch(input, expected, outSize);
+            for (int k = 0; k < kernelCount; k++) {
+                jsonSafePrefix = kernels[k].scan;
+                double rate = measure(escapeJSONString, input, length, output, outSize);
+                // No control characters in the input, so both escapers must agree
+                if (strcmp(expected, output) != 0) {
+                    fprintf(stderr, "\nMismatch from %s kernel at length %zu\n", kernels[k].name, length);
+                    return 1;
+                }
+                printf(" %15.0f", rate);
+            }
+            printf("\n");
+
+            free(input);
+            free(expected);
+            free(output);
+        }
+    }
+    return 0;
+}
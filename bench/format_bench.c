@@ -0,0 +1,65 @@
+/*
+ *
+ * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
+ * Output formats for machine consumers: size and emit throughput of pretty
+ * JSON, compact JSON, MessagePack and CBOR written from the same tree.
+ * Copyright (c) 2024-2025 Cyril John Magayaga
+ *
+ */
+#define V2_NO_MAIN
+#include "../src/v2.c"
+
+#include "corpus.h"
+
+enum { PRETTY, COMPACT, MSGPACK, CBOR, FORMATS };
+static const char *formatNames[FORMATS] = { "JSON", "JSON --compact", "MessagePack", "CBOR" };
+
+// Write the tree in one format, typed as with --checkDesignJSON; returns the bytes written
+static uint64_t emit(int format, ConfigItem *tree) {
+    OutputWriter out;
+    writerInitSink(&out, discardSink, NULL);
+    if (format == PRETTY) serializeJSONToWriter(tree, &out, 0, JSON_TYPED);
+    else if (format == COMPACT) serializeJSONToWriter(tree, &out, 0, JSON_TYPED | JSON_COMPACT);
+    else if (format == MSGPACK) serializeBinaryToWriter(tree, &out, BINARY_MSGPACK, 1);
+    else serializeBinaryToWriter(tree, &out, BINARY_CBOR, 1);
+    writerClose(&out);
+    return out.sent;
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 10;
+    if (iterations < 1) iterations = 1;
+    printf("%-11s %-15s %12s %9s %12s\n", "corpus", "format", "bytes", "vs JSON", "MB/s");
+    for (size_t c = 0; c < BENCH_CORPUS_COUNT; c++) {
+        size_t length = 0;
+        char *text = generateCorpusText(c, &length);
+        if (!text) return 1;
+
+        Arena arena;
+        arenaInit(&arena);
+        ConfigItem *tree = parseV2Buffer(text, length, &arena);
+        if (!tree) {
+            fprintf(stderr, "Failed to build the %s corpus\n", benchCorpusNames[c]);
+            return 1;
+        }
+
+        // Sizes are relative to pretty JSON; MB/s is of the source, as in traverse_bench
+        uint64_t pretty = emit(PRETTY, tree);
+        for (int format = PRETTY; format < FORMATS; format++) {
+            uint64_t bytes = 0;
+            double best = 1e9;
+            for (int i = 0; i < iterations; i++) {
+                double start = nowSeconds();
+                bytes = emit(format, tree);
+                double elapsed = nowSeconds() - start;
+                if (elapsed < best) best = elapsed;
+            }
+            printf("%-11s %-15s %12llu %8.1f%% %12.1f\n", benchCorpusNames[c], formatNames[format], (unsigned long long)bytes,
+                   100.0 * (double)bytes / (double)pretty, (double)length / (1024.0 * 1024.0) / best);
+        }
+
+        arenaRelease(&arena);
+        free(text);
+    }
+    return 0;
+}
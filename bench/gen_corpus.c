@@ -0,0 +1,70 @@
+/*
+ *
+ * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
+ * Writes a synthetic .v2 corpus of a chosen size and shape.
+ * Copyright (c) 2024-2025 Cyril John Magayaga
+ *
+ */
+#include <stdlib.h>
+
+#include "corpus.h"
+
+int main(int argc, char *argv[]) {
+    CorpusShape shape = { 1024 * 1024, 4, 0.05, 24, 0 };
+    const char *filename = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--size") == 0 && value) {
+            shape.bytes = (size_t)(strtod(value, NULL) * 1024 * 1024);
+            i++;
+        }
+
+        else if (strcmp(argv[i], "--depth") == 0 && value) {
+            shape.depth = atoi(value);
+            i++;
+        }
+
+        else if (strcmp(argv[i], "--dup") == 0 && value) {
+            shape.duplicateRatio = strtod(value, NULL);
+            i++;
+        }
+
+        else if (strcmp(argv[i], "--value") == 0 && value) {
+            shape.valueLength = (size_t)strtoul(value, NULL, 10);
+            i++;
+        }
+
+        else if (strcmp(argv[i], "--seed") == 0 && value) {
+            shape.seed = strtoull(value, NULL, 10);
+            i++;
+        }
+
+        else if (argv[i][0] != '-' && !filename) {
+            filename = argv[i];
+        }
+
+        else {
+            filename = NULL;
+            break;
+        }
+    }
+
+    if (!filename) {
+        fprintf(stderr, "Usage: %s [--size MB] [--depth N] [--dup RATIO] [--value LENGTH] [--seed N] output.v2\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(filename, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open file %s for writing\n", filename);
+        return 1;
+    }
+    size_t written = generateCorpus(file, &shape);
+    if (fclose(file) != 0) {
+        fprintf(stderr, "Failed to write %s\n", filename);
+        return 1;
+    }
+    printf("Wrote %zu bytes to %s\n", written, filename);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ *
+ * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
+ * Benchmark for path lookups on a document with 1M keys.
+ * Copyright (c) 2024-2025 Cyril John Magayaga
+ *
+ */
+#define V2_NO_MAIN
+#include "../src/v2.c"
+
+#include <time.h>
+
+#define BLOCKS 1000
+#define KEYS_PER_BLOCK 1000
+#define LOOKUPS 1000000
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// The walk the tree offers without an index: follow child/next with strcmp
+static ConfigItem *walkPath(ConfigItem *root, const char *path) {
+    char key[128];
+    ConfigItem *item = root;
+    while (*path) {
+        size_t length = strcspn(path, ".");
+        memcpy(key, path, length);
+        key[length] = '\0';
+        ConfigItem *child = item->child;
+        while (child && strcmp(child->key, key) != 0) child = child->next;
+        if (!child) return NULL;
+        item = child;
+        path += length;
+        if (*path == '.') path++;
+    }
+    return item;
+}
+
+int main(void) {
+    // A document of BLOCKS blocks with KEYS_PER_BLOCK keys each
+    size_t capacity = (size_t)BLOCKS * KEYS_PER_BLOCK * 32 + 1;
+    char *text = (char *)malloc(capacity);
+    size_t length = 0;
+    for (int b = 0; b < BLOCKS; b++) {
+        length += (size_t)sprintf(text + length, "block%d {\n", b);
+        for (int k = 0; k < KEYS_PER_BLOCK; k++) {
+            length += (size_t)sprintf(text + length, "  key%d = \"%d\"\n", k, b * KEYS_PER_BLOCK + k);
+        }
+        length += (size_t)sprintf(text + length, "}\n");
+    }
+
+    Arena arena;
+    arenaInit(&arena);
+    double start = nowSeconds();
+    ConfigItem *root = parseV2Buffer(text, length, &arena);
+    double parsed = nowSeconds();
+    PathIndex *index = buildPathIndex(root);
+    double built = nowSeconds();
+    if (!index) return 1;
+    printf("parse           %8.1f ms\n", (parsed - start) * 1e3);
+    printf("index build     %8.1f ms (%u paths)\n", (built - parsed) * 1e3, index->count);
+
+    // Random existing paths, plus some that are missing
+    char (*paths)[32] = malloc((size_t)LOOKUPS * sizeof(*paths));
+    uint64_t state = 88172645463325252ULL;
+    for (int i = 0; i < LOOKUPS; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        int b = (int)(state % BLOCKS);
+        int k = (int)((state >> 20) % KEYS_PER_BLOCK);
+        if (i % 16 == 15) sprintf(paths[i], "block%d.nokey%d", b, k);
+        else sprintf(paths[i], "block%d.key%d", b, k);
+    }
+
+    size_t found = 0;
+    start = nowSeconds();
+    for (int i = 0; i < LOOKUPS; i++) found += pathIndexFind(index, paths[i]) != NULL;
+    double indexed = nowSeconds() - start;
+    printf("indexed lookup  %8.1f ns/lookup (%zu found)\n", indexed / LOOKUPS * 1e9, found);
+
+    // The linear walk is far slower, so time it on a sample and check the answers agree
+    int walks = LOOKUPS / 100;
+    size_t walked = 0;
+    start = nowSeconds();
+    for (int i = 0; i < walks; i++) {
+        ConfigItem *item = walkPath(root, paths[i]);
+        walked += item != NULL;
+        if (item != pathIndexFind(index, paths[i])) {
+            fprintf(stderr, "Mismatch for %s\n", paths[i]);
+            return 1;
+        }
+    }
+    double walking = nowSeconds() - start;
+    printf("linear walk     %8.1f ns/lookup (%zu of %d found)\n", walking / walks * 1e9, walked, walks);
+
+    freePathIndex(index);
+    arenaRelease(&arena);
+    free(paths);
+    free(text);
+    return 0;
+}
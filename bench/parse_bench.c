@@ -0,0 +1,285 @@
+/*
+ *
+ * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
+ * Parser, emitter and validator benchmark over synthetic corpora.
+ * Prints one JSON document with MB/s, p50/p99 times and allocations per phase.
+ * Copyright (c) 2024-2025 Cyril John Magayaga
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+
+// Count every allocation the v2 sources make (atomic: the parallel parser
+// allocates from several threads)
+static _Atomic size_t allocationCount = 0;
+static _Atomic size_t allocationBytes = 0;
+
+static void *countedMalloc(size_t size) {
+    allocationCount++;
+    allocationBytes += size;
+    return malloc(size);
+}
+
+static void *countedCalloc(size_t count, size_t size) {
+    allocationCount++;
+    allocationBytes += count * size;
+    return calloc(count, size);
+}
+
+static void *countedRealloc(void *pointer, size_t size) {
+    allocationCount++;
+    allocationBytes += size;
+    return realloc(pointer, size);
+}
+
+static char *countedStrdup(const char *str) {
+    allocationCount++;
+    allocationBytes += strlen(str) + 1;
+    return strdup(str);
+}
+
+#define malloc countedMalloc
+#define calloc countedCalloc
+#define realloc countedRealloc
+#define strdup countedStrdup
+
+#define V2_NO_MAIN
+#include "../src/v2.c"
+
+#undef malloc
+#undef calloc
+#undef realloc
+#undef strdup
+
+#include <time.h>
+#include "corpus.h"
+
+#define PHASE_COUNT 7
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct Corpus {
+    const char *name;
+    CorpusShape shape;
+} Corpus;
+
+// Paths of the files a corpus is written to and read back from
+typedef struct BenchFiles {
+    char source[128];
+    char json[128];
+    char yaml[128];
+} BenchFiles;
+
+// Run one phase once; returns 0 if it failed (for the validators: if the
+// output did not pass, which is reported rather than treated as an error)
+static int runPhase(int phase, const BenchFiles *files, ConfigItem *tree, FILE *sink) {
+    switch (phase) {
+        case 0: {
+            ConfigItem *root = parseV2Config(files->source);
+            if (!root) return 0;
+            freeConfigItem(root);
+            return 1;
+        }
+        case 1: {
+            Arena arena;
+            arenaInit(&arena);
+            ConfigItem *root = parseV2ConfigMapped(files->source, &arena);
+            arenaRelease(&arena);
+            return root != NULL;
+        }
+        case 2: {
+            Arena arena;
+            arenaInit(&arena);
+            SourceBuffer source;
+            ConfigItem *root = NULL;
+            if (openSourceBuffer(files->source, &source)) {
+                root = parseV2BufferParallel(source.data, source.length, &arena, onlineCPUs());
+                closeSourceBuffer(&source);
+            }
+            arenaRelease(&arena);
+            return root != NULL;
+        }
+        case 3:
+            serializeJSON(tree, sink, 0, 0);
+            return 1;
+        case 4:
+            serializeYAML(tree, sink, 0);
+            return 1;
+        case 5:
+            return checkDesignJSON(files->json);
+        default:
+            return checkDesignYAML(files->yaml);
+    }
+}
+
+static size_t fileSize(const char *filename) {
+    struct stat info;
+    return stat(filename, &info) == 0 ? (size_t)info.st_size : 0;
+}
+
+static void benchCorpus(const Corpus *corpus, const BenchFiles *files, int iterations, int first) {
+    static const char *phaseNames[PHASE_COUNT] = {
+        "parseV2Config", "parseV2ConfigMapped", "parseV2BufferParallel", "serializeJSON", "serializeYAML", "checkDesignJSON", "checkDesignYAML"
+    };
+
+    FILE *file = fopen(files->source, "w");
+    size_t bytes = file ? generateCorpus(file, &corpus->shape) : 0;
+    if (file) fclose(file);
+
+    // The tree the emitters walk, and the outputs the validators read back
+    Arena arena;
+    arenaInit(&arena);
+    ConfigItem *tree = parseV2ConfigMapped(files->source, &arena);
+    FILE *json = fopen(files->json, "w");
+    FILE *yaml = fopen(files->yaml, "w");
+    FILE *sink = fopen("/dev/null", "w");
+    if (!tree || !json || !yaml || !sink) {
+        fprintf(stderr, "Failed to prepare corpus %s\n", corpus->name);
+        exit(1);
+    }
+    serializeJSON(tree, json, 0, 0);
+    serializeYAML(tree, yaml, 0);
+    fclose(json);
+    fclose(yaml);
+
+    // Parsers are rated on the input, emitters and validators on their output
+    size_t phaseBytes[PHASE_COUNT] = {
+        bytes, bytes, bytes, fileSize(files->json), fileSize(files->yaml), fileSize(files->json), fileSize(files->yaml)
+    };
+
+    printf("%s    {\n", first ? "" : ",\n");
+    printf("      \"corpus\": \"%s\",\n", corpus->name);
+    printf("      \"bytes\": %zu,\n", bytes);
+    printf("      \"depth\": %d,\n", corpus->shape.depth);
+    printf("      \"duplicateRatio\": %.2f,\n", corpus->shape.duplicateRatio);
+    printf("      \"valueLength\": %zu,\n", corpus->shape.valueLength);
+    printf("      \"phases\": [\n");
+
+    // The validators' diagnostics are dropped; only their verdict is kept
+    Report diagnostics;
+    writerInitMemory(&diagnostics.log);
+
+    double *samples = (double *)malloc((size_t)iterations * sizeof(double));
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        int validator = phase >= 5;
+        if (validator) reportRedirect(&diagnostics);
+        int passed = runPhase(phase, files, tree, sink);   // also warms the page cache
+        if (!passed && !validator) {
+            fprintf(stderr, "%s failed on corpus %s\n", phaseNames[phase], corpus->name);
+            exit(1);
+        }
+
+        size_t allocations = 0;
+        size_t allocated = 0;
+        for (int i = 0; i < iterations; i++) {
+            size_t count = allocationCount;
+            size_t size = allocationBytes;
+            double start = nowSeconds();
+            runPhase(phase, files, tree, sink);
+            samples[i] = nowSeconds() - start;
+            diagnostics.log.length = 0;
+            allocations = allocationCount - count;
+            allocated = allocationBytes - size;
+        }
+        reportRedirect(NULL);
+        qsort(samples, (size_t)iterations, sizeof(double), compareDoubles);
+        double p50 = samples[iterations / 2];
+        double p99 = samples[(iterations * 99 + 99) / 100 - 1];
+
+        printf("        { \"phase\": \"%s\", \"bytes\": %zu, \"iterations\": %d, \"mbPerSecond\": %.1f, "
+               "\"p50Ms\": %.3f, \"p99Ms\": %.3f, \"allocations\": %zu, \"allocatedBytes\": %zu",
+               phaseNames[phase], phaseBytes[phase], iterations, (double)phaseBytes[phase] / p50 / (1024.0 * 1024.0),
+               p50 * 1e3, p99 * 1e3, allocations, allocated);
+        if (validator) printf(", \"passed\": %s", passed ? "true" : "false");
+        printf(" }%s\n", phase + 1 < PHASE_COUNT ? "," : "");
+        fflush(stdout);
+    }
+    printf("      ]\n    }");
+    free(samples);
+    writerClose(&diagnostics.log);
+    fclose(sink);
+    arenaRelease(&arena);
+}
+
+int main(int argc, char *argv[]) {
+    Corpus corpora[] = {
+        { "flat",        { 4 * 1024 * 1024, 0, 0.0,  24,  1 } },
+        { "nested",      { 4 * 1024 * 1024, 6, 0.05, 24,  2 } },
+        { "duplicates",  { 4 * 1024 * 1024, 2, 0.5,  24,  3 } },
+        { "long-values", { 4 * 1024 * 1024, 2, 0.05, 200, 4 } },
+    };
+    size_t corpusCount = sizeof(corpora) / sizeof(corpora[0]);
+    Corpus custom = { "custom", { 4 * 1024 * 1024, 4, 0.05, 24, 5 } };
+    int iterations = 15;
+
+    // Any shape option replaces the presets with one custom corpus
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) {
+            fprintf(stderr, "Usage: %s [--size MB] [--depth N] [--dup RATIO] [--value LENGTH] [--iterations N]\n", argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--iterations") == 0) {
+            iterations = atoi(value);
+            if (iterations < 1) iterations = 1;
+        }
+
+        else if (strcmp(argv[i], "--size") == 0) {
+            custom.shape.bytes = (size_t)(strtod(value, NULL) * 1024 * 1024);
+            corpusCount = 0;
+        }
+
+        else if (strcmp(argv[i], "--depth") == 0) {
+            custom.shape.depth = atoi(value);
+            corpusCount = 0;
+        }
+
+        else if (strcmp(argv[i], "--dup") == 0) {
+            custom.shape.duplicateRatio = strtod(value, NULL);
+            corpusCount = 0;
+        }
+
+        else if (strcmp(argv[i], "--value") == 0) {
+            custom.shape.valueLength = (size_t)strtoul(value, NULL, 10);
+            corpusCount = 0;
+        }
+
+        else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        i++;
+    }
+
+    char directory[] = "/tmp/v2_bench_XXXXXX";
+    if (!mkdtemp(directory)) {
+        fprintf(stderr, "Failed to create a temporary directory\n");
+        return 1;
+    }
+    BenchFiles files;
+    snprintf(files.source, sizeof(files.source), "%s/corpus.v2", directory);
+    snprintf(files.json, sizeof(files.json), "%s/corpus.json", directory);
+    snprintf(files.yaml, sizeof(files.yaml), "%s/corpus.yaml", directory);
+
+    printf("{\n  \"threads\": %d,\n  \"corpora\": [\n", onlineCPUs());
+    if (corpusCount == 0) {
+        benchCorpus(&custom, &files, iterations, 1);
+    }
+
+    else {
+        for (size_t c = 0; c < corpusCount; c++) {
+            benchCorpus(&corpora[c], &files, iterations, c == 0);
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    remove(files.source);
+    remove(files.json);
+    remove(files.yaml);
+    rmdir(directory);
+    return 0;
+}
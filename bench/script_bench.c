@@ -0,0 +1,131 @@
+/*
+ *
+ * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
+ * v2file scripts: interpreting the source each run versus running the
+ * compiled instructions, in memory and loaded from the disk cache; then
+ * direct versus batched and pipelined execution of commands, and
+ * independent commands run one by one versus in parallel.
+ * Copyright (c) 2024-2025 Cyril John Magayaga
+ *
+ */
+#include "../src/v2file/interpreter.c"
+
+#include <time.h>
+#include <unistd.h>
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    int lines = argc > 1 ? atoi(argv[1]) : 2000;
+    int runs = argc > 2 ? atoi(argv[2]) : 500;
+
+    // Mostly print.system lines, with comments and other lines the compiler skips
+    size_t capacity = (size_t)lines * 64 + 1;
+    char *code = malloc(capacity);
+    size_t length = 0;
+    for (int i = 0; i < lines; i++) {
+        if (i % 4 == 3) length += (size_t)snprintf(code + length, capacity - length, "# comment %d\n", i);
+        else length += (size_t)snprintf(code + length, capacity - length, "print.system(line %d of the script)\n", i);
+    }
+
+    char script[] = "/tmp/v2_script_bench_XXXXXX";
+    int fd = mkstemp(script);
+    if (fd < 0 || write(fd, code, length) != (ssize_t)length) {
+        fprintf(stderr, "Failed to write the sample script\n");
+        return 1;
+    }
+    close(fd);
+    char cache[sizeof(script) + 1];
+    snprintf(cache, sizeof(cache), "%sc", script);
+
+    // The commands print; their output goes nowhere
+    FILE *report = fdopen(dup(STDOUT_FILENO), "w");
+    if (!report || !freopen("/dev/null", "w", stdout)) return 1;
+
+    double start = nowSeconds();
+    for (int i = 0; i < runs; i++) interpret(code);
+    double interpreted = nowSeconds() - start;
+
+    program prog;
+    compile_script(code, &prog);
+    start = nowSeconds();
+    for (int i = 0; i < runs; i++) run_program(&prog);
+    double compiled = nowSeconds() - start;
+
+    save_program(&prog, cache, script);
+    free_program(&prog);
+    start = nowSeconds();
+    for (int i = 0; i < runs; i++) {
+        if (!load_program(&prog, cache, script)) return 1;
+        run_program(&prog);
+        free_program(&prog);
+    }
+    double cached = nowSeconds() - start;
+
+    fprintf(report, "%d-line script, %d runs (us per run)\n", lines, runs);
+    fprintf(report, "%-32s %10.1f\n", "interpret (compile every run)", interpreted / runs * 1e6);
+    fprintf(report, "%-32s %10.1f\n", "run compiled program", compiled / runs * 1e6);
+    fprintf(report, "%-32s %10.1f\n", "load from cache, then run", cached / runs * 1e6);
+
+    // Prints, file creations and commands mixed, run directly and batched
+    char directory[] = "/tmp/v2_script_bench_dir_XXXXXX";
+    if (!mkdtemp(directory)) return 1;
+    int commands = lines / 20;
+    length = 0;
+    for (int i = 0; i < lines; i++) {
+        if (i % 20 == 0) length += (size_t)snprintf(code + length, capacity - length, "os.system(true)\n");
+        else if (i % 2 == 0) length += (size_t)snprintf(code + length, capacity - length, "createfile.system(%s/f%d)\n", directory, i % 100);
+        else length += (size_t)snprintf(code + length, capacity - length, "print.system(line %d of the script)\n", i);
+    }
+    compile_script(code, &prog);
+
+    static const char *modes[] = { "run_program", "run_program_batched", "run_program_batched, pipelined" };
+    fprintf(report, "\n%d-line script with %d commands (ms per run)\n", lines, commands);
+    for (int mode = 0; mode < 3; mode++) {
+        start = nowSeconds();
+        for (int i = 0; i < 5; i++) {
+            if (mode == 0) run_program(&prog);
+            else run_program_batched(&prog, mode == 2);
+        }
+        fflush(stdout);
+        fprintf(report, "%-32s %10.1f\n", modes[mode], (nowSeconds() - start) / 5 * 1e3);
+    }
+    free_program(&prog);
+
+    // Independent commands that mostly wait, as provisioning steps do
+    int sleepers = 32;
+    length = 0;
+    for (int i = 0; i < sleepers; i++) {
+        length += (size_t)snprintf(code + length, capacity - length, "os.system(sleep 0.02)\n");
+    }
+    compile_script(code, &prog);
+    fprintf(report, "\n%d commands of 20 ms each (ms per run)\n", sleepers);
+    start = nowSeconds();
+    run_program(&prog);
+    fprintf(report, "%-32s %10.1f\n", "run_program", (nowSeconds() - start) * 1e3);
+    for (uint32_t jobs = 2; jobs <= 8; jobs *= 2) {
+        char label[64];
+        snprintf(label, sizeof(label), "run_program_parallel, %u jobs", jobs);
+        start = nowSeconds();
+        run_program_parallel(&prog, jobs);
+        fprintf(report, "%-32s %10.1f\n", label, (nowSeconds() - start) * 1e3);
+    }
+    free_program(&prog);
+    fclose(report);
+
+    for (int i = 0; i < 100; i += 2) {
+        char path[sizeof(directory) + 16];
+        snprintf(path, sizeof(path), "%s/f%d", directory, i);
+        unlink(path);
+    }
+    rmdir(directory);
+
+    unlink(script);
+    unlink(cache);
+    free(code);
+    return 0;
+}
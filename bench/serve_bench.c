@@ -0,0 +1,184 @@
+/*
+ *
+ * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
+ * Latency of transpiling through `v2 --serve` versus running ./v2 once per file.
+ * Copyright (c) 2024-2025 Cyril John Magayaga
+ *
+ */
+#define V2_NO_MAIN
+#include "../src/v2.c"
+
+#include <time.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void printLatencies(const char *label, double *samples, size_t count) {
+    double total = 0;
+    for (size_t i = 0; i < count; i++) total += samples[i];
+    qsort(samples, count, sizeof(double), compareDoubles);
+    printf("%-28s %10.1f %10.1f %10.1f\n", label,
+           samples[count / 2] * 1e6, samples[count * 99 / 100] * 1e6, total / (double)count * 1e6);
+}
+
+// A typical service configuration: a few dozen keys in nested blocks
+static char *makeConfig(size_t *length) {
+    OutputWriter out;
+    writerInitMemory(&out);
+    char line[128];
+    for (int service = 0; service < 8; service++) {
+        snprintf(line, sizeof(line), "service%d {\n", service);
+        writerPutString(&out, line);
+        snprintf(line, sizeof(line), "   name = \"service-%d\"\n   port = %d\n   enabled = true\n", service, 8000 + service);
+        writerPutString(&out, line);
+        writerPutString(&out, "   limits {\n      cpu = \"500m\"\n      memory = \"256Mi\"\n   }\n}\n");
+    }
+    *length = out.length;
+    return out.buffer;
+}
+
+static int connectTo(const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+// One request and its whole reply; returns 1 on a V2_FRAME_OK reply
+static int roundTrip(int fd, const char *request, size_t requestLength, char *reply, size_t replyCapacity) {
+    if (send(fd, request, requestLength, MSG_NOSIGNAL) != (ssize_t)requestLength) return 0;
+    size_t received = 0;
+    size_t expected = V2_FRAME_HEADER;
+    while (received < expected) {
+        ssize_t chunk = recv(fd, reply + received, replyCapacity - received, 0);
+        if (chunk <= 0) return 0;
+        received += (size_t)chunk;
+        if (received >= V2_FRAME_HEADER) expected = V2_FRAME_HEADER + frameLength(reply);
+        if (expected > replyCapacity) return 0;
+    }
+    return reply[0] == V2_FRAME_OK;
+}
+
+typedef struct ServeThread {
+    const char *path;
+    int workers;
+} ServeThread;
+
+static void *serveThread(void *arg) {
+    ServeThread *serve = (ServeThread *)arg;
+    serveRequests(serve->path, serve->workers);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    const char *binary = argc > 1 ? argv[1] : "./v2";
+    size_t requests = 5000;
+    size_t spawns = 300;
+
+    size_t length;
+    char *config = makeConfig(&length);
+    char configPath[] = "/tmp/v2_serve_bench_XXXXXX";
+    int configFd = mkstemp(configPath);
+    if (configFd < 0 || write(configFd, config, length) != (ssize_t)length) {
+        fprintf(stderr, "Failed to write the sample config\n");
+        return 1;
+    }
+    close(configFd);
+
+    char socketPath[64];
+    snprintf(socketPath, sizeof(socketPath), "/tmp/v2_serve_bench_%d.sock", (int)getpid());
+    ServeThread serve = { socketPath, onlineCPUs() };
+    pthread_t thread;
+    pthread_create(&thread, NULL, serveThread, &serve);
+    int fd = -1;
+    for (int attempt = 0; attempt < 200 && fd < 0; attempt++) {
+        fd = connectTo(socketPath);
+        if (fd < 0) usleep(10000);
+    }
+    if (fd < 0) {
+        fprintf(stderr, "Server did not start\n");
+        return 1;
+    }
+
+    char *request = (char *)malloc(V2_FRAME_HEADER + length);
+    frameHeader(request, V2_FRAME_JSON, length);
+    memcpy(request + V2_FRAME_HEADER, config, length);
+    size_t replyCapacity = 1 << 20;
+    char *reply = (char *)malloc(replyCapacity);
+    double *samples = (double *)malloc(requests * sizeof(double));
+
+    printf("%zu-byte config, %d server worker%s\n", length, serve.workers, serve.workers == 1 ? "" : "s");
+    printf("%-28s %10s %10s %10s\n", "", "p50 us", "p99 us", "mean us");
+
+    // Warm-up, then one persistent connection
+    for (int i = 0; i < 100; i++) roundTrip(fd, request, V2_FRAME_HEADER + length, reply, replyCapacity);
+    for (size_t i = 0; i < requests; i++) {
+        double start = nowSeconds();
+        if (!roundTrip(fd, request, V2_FRAME_HEADER + length, reply, replyCapacity)) {
+            fprintf(stderr, "Request failed\n");
+            return 1;
+        }
+        samples[i] = nowSeconds() - start;
+    }
+    close(fd);
+    printLatencies("--serve, kept connection", samples, requests);
+
+    // A new connection for every request
+    for (size_t i = 0; i < requests; i++) {
+        double start = nowSeconds();
+        int each = connectTo(socketPath);
+        if (each < 0 || !roundTrip(each, request, V2_FRAME_HEADER + length, reply, replyCapacity)) {
+            fprintf(stderr, "Request failed\n");
+            return 1;
+        }
+        close(each);
+        samples[i] = nowSeconds() - start;
+    }
+    printLatencies("--serve, connect per file", samples, requests);
+
+    // A process per file, writing to a pipe-like sink as a pipeline would
+    char *arguments[] = { (char *)binary, "--transpiler::json", "--stdout", configPath, NULL };
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    for (size_t i = 0; i < spawns; i++) {
+        double start = nowSeconds();
+        pid_t child;
+        int status = 0;
+        if (posix_spawn(&child, binary, &actions, NULL, arguments, environ) != 0 ||
+            waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "Failed to run %s (pass the path to the v2 binary)\n", binary);
+            return 1;
+        }
+        samples[i] = nowSeconds() - start;
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    printLatencies("exec per file", samples, spawns);
+
+    unlink(configPath);
+    unlink(socketPath);
+    free(samples);
+    free(reply);
+    free(request);
+    free(config);
+    return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ *
+ * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
+ * Traversal throughput of the linked ConfigItem tree (malloc'd nodes, and
+ * nodes in an arena) against the flat layout built by flattenConfig.
+ * Copyright (c) 2024-2025 Cyril John Magayaga
+ *
+ */
+#define V2_NO_MAIN
+#include "../src/v2.c"
+
+#include "corpus.h"
+
+// A bare walk: visit every node and read its key and value
+static size_t walkTree(const ConfigItem *item) {
+    size_t sum = 0;
+    for (const ConfigItem *child = item->child; child; child = child->next) {
+        sum += (unsigned char)child->key[0];
+        if (child->value) sum += child->valueLength;
+        else sum += walkTree(child);
+    }
+    return sum;
+}
+
+static size_t walkFlat(const CompiledConfig *config) {
+    size_t sum = 0;
+    for (uint32_t i = 1; i < config->nodeCount; i++) {
+        const CompiledNode *node = &config->nodes[i];
+        sum += (unsigned char)config->strings[node->key];
+        if (node->value != COMPILED_NO_VALUE) sum += node->valueLength;
+    }
+    return sum;
+}
+
+enum { WALK, JSON, YAML, KINDS };
+static const char *kindNames[KINDS] = { "walk", "serializeJSON", "serializeYAML" };
+
+// Run one traversal; returns the bytes it produced (nodes visited for WALK)
+static uint64_t traverse(int kind, ConfigItem *tree, const CompiledConfig *flat) {
+    if (kind == WALK) return tree ? walkTree(tree) : walkFlat(flat);
+
+    OutputWriter out;
+    writerInitSink(&out, discardSink, NULL);
+    if (kind == JSON && tree) serializeJSONToWriter(tree, &out, 0, 1);
+    else if (kind == JSON) serializeCompiledJSONToWriter(flat, 0, &out, 0, 1);
+    else if (tree) serializeYAMLToWriter(tree, &out, 0);
+    else serializeCompiledYAMLToWriter(flat, 0, &out, 0);
+    writerClose(&out);
+    return out.sent;
+}
+
+// Function to render a traversal into memory, to check the layouts agree
+static char *render(int kind, ConfigItem *tree, const CompiledConfig *flat, size_t *length) {
+    OutputWriter out;
+    writerInitMemory(&out);
+    if (kind == JSON && tree) serializeJSONToWriter(tree, &out, 0, 1);
+    else if (kind == JSON) serializeCompiledJSONToWriter(flat, 0, &out, 0, 1);
+    else if (tree) serializeYAMLToWriter(tree, &out, 0);
+    else serializeCompiledYAMLToWriter(flat, 0, &out, 0);
+    *length = out.length;
+    return out.buffer;
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 10;
+    if (iterations < 1) iterations = 1;
+    printf("%-11s %-14s %12s %12s %12s\n", "corpus", "traversal", "malloc MB/s", "arena MB/s", "flat MB/s");
+    for (size_t c = 0; c < BENCH_CORPUS_COUNT; c++) {
+        size_t length = 0;
+        char *text = generateCorpusText(c, &length);
+        if (!text) return 1;
+
+        // The same document three ways
+        Arena arena;
+        arenaInit(&arena);
+        ConfigItem *linked = parseV2Buffer(text, length, NULL);
+        ConfigItem *arenaTree = parseV2Buffer(text, length, &arena);
+        CompiledConfig flat;
+        if (!linked || !arenaTree || !flattenConfig(arenaTree, &flat)) {
+            fprintf(stderr, "Failed to build the %s corpus\n", benchCorpusNames[c]);
+            return 1;
+        }
+
+        for (int kind = WALK; kind < KINDS; kind++) {
+            if (kind != WALK) {
+                size_t treeLength;
+                size_t flatLength;
+                char *fromTree = render(kind, linked, NULL, &treeLength);
+                char *fromFlat = render(kind, NULL, &flat, &flatLength);
+                int same = treeLength == flatLength && memcmp(fromTree, fromFlat, treeLength) == 0;
+                free(fromTree);
+                free(fromFlat);
+                if (!same) {
+                    fprintf(stderr, "%s output differs between layouts on %s\n", kindNames[kind], benchCorpusNames[c]);
+                    return 1;
+                }
+            }
+
+            // Throughput is measured against the source size, so the columns compare
+            double rates[3];
+            ConfigItem *trees[3] = { linked, arenaTree, NULL };
+            for (int layout = 0; layout < 3; layout++) {
+                volatile uint64_t produced = 0;
+                double best = 1e9;
+                for (int i = 0; i < iterations; i++) {
+                    double start = nowSeconds();
+                    produced += traverse(kind, trees[layout], &flat);
+                    double elapsed = nowSeconds() - start;
+                    if (elapsed < best) best = elapsed;
+                }
+                rates[layout] = (double)length / (1024.0 * 1024.0) / best;
+            }
+            printf("%-11s %-14s %12.1f %12.1f %12.1f\n", benchCorpusNames[c], kindNames[kind], rates[0], rates[1], rates[2]);
+        }
+
+        closeCompiledConfig(&flat);
+        freeConfigItem(linked);
+        arenaRelease(&arena);
+        free(text);
+    }
+    return 0;
+}
@@ -9,6 +9,55 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <float.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "v2.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define V2_X86_SIMD 1
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+// Status lines and diagnostics; a parallel run captures them per file
+void reportStatus(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void reportError(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+// What a value is, decided once when its node is created
+enum {
+    VALUE_STRING,
+    VALUE_INT,
+    VALUE_FLOAT,
+    VALUE_BOOL,
+    VALUE_NULL
+};
+
+// Flags saying which emitters have to rewrite a value
+#define VALUE_NEEDS_ESCAPE 0x01   // has bytes JSON must escape
+#define VALUE_NEEDS_QUOTES 0x02   // has bytes that make YAML quote it
 
 // Define the basic data structure for a configuration item
 typedef struct ConfigItem {
@@ -16,39 +65,219 @@ typedef struct ConfigItem {
     char *value;
     struct ConfigItem *next;
     struct ConfigItem *child;
+    struct ConfigItem *lastChild;
+    uint32_t valueLength;      // strlen(value)
+    uint8_t valueType;         // VALUE_*
+    uint8_t valueFlags;        // VALUE_NEEDS_*
+    uint8_t keyInterned;       // key is the text of an InternedKey
 } ConfigItem;
 
-// Function to create a new ConfigItem
-ConfigItem *createConfigItem(const char *key, const char *value) {
-    ConfigItem *item = (ConfigItem *)malloc(sizeof(ConfigItem));
+// Bump allocator that owns every node and string of one parsed document
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used;
+    size_t size;
+    unsigned char data[];
+} ArenaBlock;
+
+// A key stored once per arena; every node with that key points at text
+typedef struct InternedKey {
+    uint64_t owner;        // KeyInterner.owner of the table that holds it
+    uint64_t hash;         // hashKey(text)
+    const char *json;      // text escaped for JSON, without quotes; NULL if it needs no escaping
+    uint32_t jsonLength;
+    uint32_t length;       // strlen(text)
+    char text[];
+} InternedKey;
+
+// Open-addressed table of the keys interned in one arena
+typedef struct KeyInterner {
+    uint64_t owner;        // unique per table, even after earlier tables are freed
+    InternedKey **slots;
+    size_t mask;
+    size_t count;
+    size_t hits;           // lookups that found a key already stored
+    int closed;            // keys turned out mostly distinct; later ones are copied
+} KeyInterner;
+
+typedef struct Arena {
+    ArenaBlock *head;
+    size_t nextBlockSize;
+    KeyInterner *interner;   // made on the first interned key
+} Arena;
+
+#define ARENA_MIN_BLOCK (64 * 1024)
+#define ARENA_MAX_BLOCK (4 * 1024 * 1024)
+
+// Function to initialize an empty Arena
+void arenaInit(Arena *arena) {
+    arena->head = NULL;
+    arena->nextBlockSize = ARENA_MIN_BLOCK;
+    arena->interner = NULL;
+}
+
+// Function to allocate aligned memory from an Arena
+void *arenaAlloc(Arena *arena, size_t size, size_t align) {
+    ArenaBlock *block = arena->head;
+    if (block) {
+        uintptr_t base = (uintptr_t)block->data;
+        size_t offset = (size_t)(((base + block->used + align - 1) & ~(uintptr_t)(align - 1)) - base);
+        if (offset + size <= block->size) {
+            block->used = offset + size;
+            return block->data + offset;
+        }
+    }
+
+    // Start a new block; oversized requests get a block of their own
+    size_t blockSize = arena->nextBlockSize;
+    if (blockSize < size + align) {
+        blockSize = size + align;
+    }
+    else if (arena->nextBlockSize < ARENA_MAX_BLOCK) {
+        arena->nextBlockSize *= 2;
+    }
+
+    block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + blockSize);
+    if (!block) {
+        reportError("Memory allocation failed\n");
+        return NULL;
+    }
+    block->size = blockSize;
+    block->next = arena->head;
+    arena->head = block;
+
+    uintptr_t base = (uintptr_t)block->data;
+    size_t offset = (size_t)(((base + align - 1) & ~(uintptr_t)(align - 1)) - base);
+    block->used = offset + size;
+    return block->data + offset;
+}
+
+// Function to measure an Arena: the bytes its blocks reserve, and how many blocks there are
+size_t arenaUsage(const Arena *arena, size_t *blocks) {
+    size_t bytes = 0;
+    *blocks = 0;
+    for (const ArenaBlock *block = arena->head; block; block = block->next) {
+        bytes += sizeof(ArenaBlock) + block->size;
+        (*blocks)++;
+    }
+    if (arena->interner) {
+        bytes += sizeof(KeyInterner) + (arena->interner->mask + 1) * sizeof(InternedKey *);
+        *blocks += 2;
+    }
+    return bytes;
+}
+
+// Function to free the key table of an Arena; the keys themselves stay in its blocks
+static void arenaDropInterner(Arena *arena) {
+    if (arena->interner) {
+        free(arena->interner->slots);
+        free(arena->interner);
+        arena->interner = NULL;
+    }
+}
+
+// Function to move every block of another Arena into this one, leaving the other empty
+void arenaAdopt(Arena *arena, Arena *other) {
+    // The other table's keys move too; they are compared by content from now on
+    arenaDropInterner(other);
+    if (!other->head) return;
+    ArenaBlock *tail = other->head;
+    while (tail->next) tail = tail->next;
+    tail->next = arena->head;
+    arena->head = other->head;
+    if (other->nextBlockSize > arena->nextBlockSize) arena->nextBlockSize = other->nextBlockSize;
+    arenaInit(other);
+}
+
+// Function to release every allocation of an Arena at once
+void arenaRelease(Arena *arena) {
+    ArenaBlock *block = arena->head;
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arenaDropInterner(arena);
+    arena->head = NULL;
+    arena->nextBlockSize = ARENA_MIN_BLOCK;
+}
+
+// Copy a string slice that is not NUL-terminated (into the arena if given)
+static char *copyString(Arena *arena, const char *str, size_t length) {
+    char *copy = arena ? (char *)arenaAlloc(arena, length + 1, 1) : (char *)malloc(length + 1);
+    if (copy) {
+        memcpy(copy, str, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+static uint8_t classifyValue(const char *value, size_t length, uint8_t *flags);
+static char *internKey(Arena *arena, const char *key, size_t length);
+
+// Keys at least this long are copied per node rather than interned
+#define KEY_INTERN_MAX (UINT32_MAX / 8)
+// Distinct keys seen before an arena may decide interning does not pay
+#define KEY_INTERN_SAMPLE 4096
+
+// Function to create a new ConfigItem from key and value slices.
+// With an arena the node and its strings live until the arena is released;
+// without one they are malloc'd and owned by freeConfigItem.
+ConfigItem *createConfigItemSized(Arena *arena, const char *key, size_t keyLength, const char *value, size_t valueLength) {
+    ConfigItem *item = arena ? (ConfigItem *)arenaAlloc(arena, sizeof(ConfigItem), _Alignof(ConfigItem))
+                             : (ConfigItem *)malloc(sizeof(ConfigItem));
     if (!item) {
-        fprintf(stderr, "Memory allocation failed\n");
+        reportError("Memory allocation failed\n");
         return NULL;
     }
-    item->key = strdup(key);
+    // Keys end at a NUL too; in an arena, equal keys share one interned copy
+    const char *keyEnd = (const char *)memchr(key, '\0', keyLength);
+    if (keyEnd) keyLength = (size_t)(keyEnd - key);
+    item->key = NULL;
+    if (arena && keyLength < KEY_INTERN_MAX && !(arena->interner && arena->interner->closed)) {
+        item->key = internKey(arena, key, keyLength);
+    }
+    item->keyInterned = item->key != NULL;
+    if (!item->key) item->key = copyString(arena, key, keyLength);
     if (!item->key) {
-        free(item);
-        fprintf(stderr, "Memory allocation failed\n");
+        if (!arena) free(item);
+        reportError("Memory allocation failed\n");
         return NULL;
     }
     if (value) {
-        item->value = strdup(value);
+        // A NUL inside the slice ends the value, as it always has
+        const char *nul = (const char *)memchr(value, '\0', valueLength);
+        if (nul) valueLength = (size_t)(nul - value);
+        item->value = valueLength < UINT32_MAX ? copyString(arena, value, valueLength) : NULL;
         if (!item->value) {
-            free(item->key);
-            free(item);
-            fprintf(stderr, "Memory allocation failed\n");
+            if (!arena) {
+                free(item->key);
+                free(item);
+            }
+            reportError(valueLength < UINT32_MAX ? "Memory allocation failed\n" : "Value too long\n");
             return NULL;
         }
+        item->valueLength = (uint32_t)valueLength;
+        item->valueType = classifyValue(item->value, valueLength, &item->valueFlags);
     }
     
     else {
         item->value = NULL;
+        item->valueLength = 0;
+        item->valueType = VALUE_NULL;
+        item->valueFlags = 0;
     }
     item->next = NULL;
     item->child = NULL;
+    item->lastChild = NULL;
     return item;
 }
 
+// Function to create a new ConfigItem
+ConfigItem *createConfigItem(const char *key, const char *value) {
+    return createConfigItemSized(NULL, key, strlen(key), value, value ? strlen(value) : 0);
+}
+
 // Function to add a child to a ConfigItem
 void addChild(ConfigItem *parent, ConfigItem *child) {
     if (!parent->child) {
@@ -56,34 +285,44 @@ void addChild(ConfigItem *parent, ConfigItem *child) {
     }
     
     else {
-        ConfigItem *sibling = parent->child;
+        // Start from the remembered tail, so appends cost O(1)
+        ConfigItem *sibling = parent->lastChild ? parent->lastChild : parent->child;
         while (sibling->next) {
             sibling = sibling->next;
         }
         sibling->next = child;
     }
+    parent->lastChild = child;
 }
 
-// Function to free a ConfigItem
+// Function to free a malloc'd ConfigItem and its siblings
 void freeConfigItem(ConfigItem *item) {
-    if (item) {
+    // Recurse only into children; sibling chains are walked iteratively
+    while (item) {
+        ConfigItem *next = item->next;
         if (item->key) free(item->key);
         if (item->value) free(item->value);
         if (item->child) freeConfigItem(item->child);
-        if (item->next) freeConfigItem(item->next);
         free(item);
+        item = next;
     }
 }
 
-// Function to parse a .v2 configuration file
-ConfigItem *parseV2Config(const char *filename) {
+// Drop a partially built tree on a parse error
+static void discardConfigItem(Arena *arena, ConfigItem *root) {
+    // Arena-backed nodes go away with the arena itself
+    if (!arena) freeConfigItem(root);
+}
+
+// Function to parse a .v2 configuration file line by line into an arena
+ConfigItem *parseV2ConfigInto(const char *filename, Arena *arena) {
     FILE *file = fopen(filename, "r");
     if (!file) {
-        fprintf(stderr, "Failed to open file %s\n", filename);
+        reportError("Failed to open file %s\n", filename);
         return NULL;
     }
 
-    ConfigItem *root = createConfigItem("root", NULL);
+    ConfigItem *root = createConfigItemSized(arena, "root", 4, NULL, 0);
     if (!root) {
         fclose(file);
         return NULL;
@@ -99,6 +338,7 @@ ConfigItem *parseV2Config(const char *filename) {
         if (line[0] == '#' || line[0] == '\n') continue;
 
         char key[128], value[128];
+        int consumed = 0;
         if (sscanf(line, " %127[^=]=%127[^\n]", key, value) == 2) {
             // Trim trailing whitespace from key
             char *end = key + strlen(key) - 1;
@@ -106,29 +346,35 @@ ConfigItem *parseV2Config(const char *filename) {
                 *end-- = '\0';
             }
             
-            ConfigItem *item = createConfigItem(key, value);
+            ConfigItem *item = createConfigItemSized(arena, key, strlen(key), value, strlen(value));
             if (!item) {
                 fclose(file);
-                freeConfigItem(root);
+                discardConfigItem(arena, root);
                 return NULL;
             }
             addChild(current, item);
         }
         
-        else if (sscanf(line, " %127[^{] {", key) == 1) {
+        else if (sscanf(line, " %127[^{] {%n", key, &consumed) == 1 && consumed > 0) {
             // Trim trailing whitespace from key
             char *end = key + strlen(key) - 1;
             while (end > key && isspace((unsigned char)*end)) {
                 *end-- = '\0';
             }
             
-            ConfigItem *item = createConfigItem(key, NULL);
+            ConfigItem *item = createConfigItemSized(arena, key, strlen(key), NULL, 0);
             if (!item) {
                 fclose(file);
-                freeConfigItem(root);
+                discardConfigItem(arena, root);
                 return NULL;
             }
             addChild(current, item);
+            if (stackIndex == (int)(sizeof(stack) / sizeof(stack[0]))) {
+                reportError("Syntax error: Blocks nested too deeply\n");
+                fclose(file);
+                discardConfigItem(arena, root);
+                return NULL;
+            }
             stack[stackIndex++] = current;
             current = item;
         }
@@ -139,9 +385,9 @@ ConfigItem *parseV2Config(const char *filename) {
             }
             
             else {
-                fprintf(stderr, "Syntax error: Unmatched closing brace\n");
+                reportError("Syntax error: Unmatched closing brace\n");
                 fclose(file);
-                freeConfigItem(root);
+                discardConfigItem(arena, root);
                 return NULL;
             }
         }
@@ -151,489 +397,5646 @@ ConfigItem *parseV2Config(const char *filename) {
     return root;
 }
 
-// Function to escape JSON strings
-void escapeJSONString(const char *input, char *output, size_t outSize) {
-    size_t outIndex = 0;
-    
-    while (*input && outIndex < outSize - 1) {
-        switch (*input) {
-            case '"': 
-                if (outIndex + 2 < outSize) {
-                    output[outIndex++] = '\\'; 
-                    output[outIndex++] = '"'; 
-                }
-                break;
-            case '\\': 
-                if (outIndex + 2 < outSize) {
-                    output[outIndex++] = '\\'; 
-                    output[outIndex++] = '\\'; 
-                }
-                break;
-            case '\b': 
-                if (outIndex + 2 < outSize) {
-                    output[outIndex++] = '\\'; 
-                    output[outIndex++] = 'b'; 
-                }
-                break;
-            case '\f': 
-                if (outIndex + 2 < outSize) {
-                    output[outIndex++] = '\\'; 
-                    output[outIndex++] = 'f'; 
-                }
-                break;
-            case '\n': 
-                if (outIndex + 2 < outSize) {
-                    output[outIndex++] = '\\'; 
-                    output[outIndex++] = 'n'; 
-                }
-                break;
-            case '\r': 
-                if (outIndex + 2 < outSize) {
-                    output[outIndex++] = '\\'; 
-                    output[outIndex++] = 'r'; 
-                }
-                break;
-            case '\t': 
-                if (outIndex + 2 < outSize) {
-                    output[outIndex++] = '\\'; 
-                    output[outIndex++] = 't'; 
-                }
-                break;
-            default: 
-                output[outIndex++] = *input; 
-                break;
+// Function to parse a .v2 configuration file
+ConfigItem *parseV2Config(const char *filename) {
+    return parseV2ConfigInto(filename, NULL);
+}
+
+// Whole-file view of a .v2 source, either memory-mapped or read in one piece
+typedef struct SourceBuffer {
+    const char *data;
+    size_t length;
+    int mapped;
+} SourceBuffer;
+
+// Function to tell whether a filename is "-", which stands for stdin or stdout
+int isStandardStream(const char *filename) {
+    return filename[0] == '-' && filename[1] == '\0';
+}
+
+// Function to load a file ("-" for stdin) into a SourceBuffer
+int openSourceBuffer(const char *filename, SourceBuffer *source) {
+    source->data = NULL;
+    source->length = 0;
+    source->mapped = 0;
+    int fromStdin = isStandardStream(filename);
+
+#ifndef _WIN32
+    // Stdin redirected from a regular file is mapped like any other file
+    int fd = fromStdin ? STDIN_FILENO : open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && (!fromStdin || lseek(fd, 0, SEEK_CUR) == 0)) {
+        if (info.st_size == 0) {
+            if (!fromStdin) close(fd);
+            return 1;
+        }
+
+        void *map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+            madvise(map, (size_t)info.st_size, MADV_SEQUENTIAL);
+#endif
+            if (!fromStdin) close(fd);
+            source->data = (const char *)map;
+            source->length = (size_t)info.st_size;
+            source->mapped = 1;
+            return 1;
         }
-        input++;
     }
-    output[outIndex] = '\0';
+    if (!fromStdin) close(fd);
+#endif
+
+    // Not mappable (pipe, special file, or no mmap): read it once in large chunks
+    FILE *file = fromStdin ? stdin : fopen(filename, "r");
+    if (!file) return 0;
+
+    char *data = NULL;
+    size_t length = 0;
+    size_t capacity = 0;
+    for (;;) {
+        if (length == capacity) {
+            size_t newCapacity = capacity ? capacity * 2 : 65536;
+            char *grown = (char *)realloc(data, newCapacity);
+            if (!grown) {
+                free(data);
+                if (!fromStdin) fclose(file);
+                reportError("Memory allocation failed\n");
+                return 0;
+            }
+            data = grown;
+            capacity = newCapacity;
+        }
+
+        size_t bytesRead = fread(data + length, 1, capacity - length, file);
+        if (bytesRead == 0) break;
+        length += bytesRead;
+    }
+
+    int failed = ferror(file);
+    if (!fromStdin) fclose(file);
+    if (failed) {
+        free(data);
+        return 0;
+    }
+
+    source->data = data;
+    source->length = length;
+    return 1;
 }
 
-// Count how many times a key appears in siblings
-int countSameKey(ConfigItem *start, const char *key) {
-    int count = 0;
-    while (start) {
-        if (strcmp(start->key, key) == 0) count++;
-        start = start->next;
+// Function to release a SourceBuffer
+void closeSourceBuffer(SourceBuffer *source) {
+#ifndef _WIN32
+    if (source->mapped) {
+        munmap((void *)source->data, source->length);
     }
-    return count;
+
+    else
+#endif
+    {
+        free((void *)source->data);
+    }
+    source->data = NULL;
+    source->length = 0;
+    source->mapped = 0;
 }
 
-// Safely write a key or value to JSON
-void writeJSONString(FILE *file, const char *str) {
-    char escaped[512]; // Increased buffer size for safety
-    escapeJSONString(str, escaped, sizeof(escaped));
-    fprintf(file, "\"%s\"", escaped);
+// 64-bit content hash (the XXH64 algorithm) for comparing whole files and outputs
+#define HASH_PRIME1 0x9E3779B185EBCA87ULL
+#define HASH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define HASH_PRIME3 0x165667B19E3779F9ULL
+#define HASH_PRIME4 0x85EBCA77C2B2AE63ULL
+#define HASH_PRIME5 0x27D4EB2F165667C5ULL
+
+static uint64_t hashRotate(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
 }
 
-// Function to determine value type for JSON
-int isNumeric(const char *str) {
-    if (!str) return 0;
-    char *endptr;
-    strtod(str, &endptr);
-    return *endptr == '\0';
+static uint64_t hashRead64(const unsigned char *p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
 }
 
-int isBoolean(const char *str) {
-    if (!str) return 0;
-    return (strcmp(str, "true") == 0 || strcmp(str, "false") == 0);
+static uint32_t hashRead32(const unsigned char *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
 }
 
-int isNull(const char *str) {
-    if (!str) return 1;
-    return (strcmp(str, "null") == 0);
+static uint64_t hashRound(uint64_t accumulator, uint64_t input) {
+    accumulator += input * HASH_PRIME2;
+    accumulator = hashRotate(accumulator, 31);
+    return accumulator * HASH_PRIME1;
 }
 
-// JSON serialization (children only) with proper formatting
-void serializeJSON(ConfigItem *item, FILE *file, int indent, int checkDesign) {
-    if (!item || !item->child) {
-        fprintf(file, "{}");
-        return;
+static uint64_t hashMerge(uint64_t hash, uint64_t accumulator) {
+    hash ^= hashRound(0, accumulator);
+    return hash * HASH_PRIME1 + HASH_PRIME4;
+}
+
+// Function to hash a block of bytes
+uint64_t hashContent(const void *data, size_t length, uint64_t seed) {
+    const unsigned char *p = (const unsigned char *)data;
+    const unsigned char *end = p + length;
+    uint64_t hash;
+
+    if (length >= 32) {
+        uint64_t v1 = seed + HASH_PRIME1 + HASH_PRIME2;
+        uint64_t v2 = seed + HASH_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - HASH_PRIME1;
+        do {
+            v1 = hashRound(v1, hashRead64(p));
+            v2 = hashRound(v2, hashRead64(p + 8));
+            v3 = hashRound(v3, hashRead64(p + 16));
+            v4 = hashRound(v4, hashRead64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+
+        hash = hashRotate(v1, 1) + hashRotate(v2, 7) + hashRotate(v3, 12) + hashRotate(v4, 18);
+        hash = hashMerge(hash, v1);
+        hash = hashMerge(hash, v2);
+        hash = hashMerge(hash, v3);
+        hash = hashMerge(hash, v4);
+    }
+    
+    else {
+        hash = seed + HASH_PRIME5;
     }
+    hash += (uint64_t)length;
 
-    ConfigItem *child = item->child;
-    fprintf(file, "{\n");
-    int first = 1;
+    while (end - p >= 8) {
+        hash ^= hashRound(0, hashRead64(p));
+        hash = hashRotate(hash, 27) * HASH_PRIME1 + HASH_PRIME4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        hash ^= (uint64_t)hashRead32(p) * HASH_PRIME1;
+        hash = hashRotate(hash, 23) * HASH_PRIME2 + HASH_PRIME3;
+        p += 4;
+    }
+    while (p < end) {
+        hash ^= (*p++) * HASH_PRIME5;
+        hash = hashRotate(hash, 11) * HASH_PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
 
-    // Calculate indentation
-    char indentStr[128] = "";
-    for (int i = 0; i < indent + 1; i++) {
-        strcat(indentStr, "    ");
+// Trim trailing whitespace from a slice, keeping at least one character
+static const char *trimSliceEnd(const char *start, const char *end) {
+    while (end > start + 1 && isspace((unsigned char)end[-1])) {
+        end--;
     }
+    return end;
+}
 
-    while (child) {
-        if (!first) fprintf(file, ",\n");
-        first = 0;
+// Callbacks of the event (SAX-style) parser. Keys and values are slices of
+// the input and are not NUL-terminated; a callback returns 0 to stop.
+typedef struct ConfigEvents {
+    int (*beginBlock)(void *context, const char *key, size_t keyLength);
+    int (*keyValue)(void *context, const char *key, size_t keyLength, const char *value, size_t valueLength);
+    int (*endBlock)(void *context);
+} ConfigEvents;
 
-        // Print indentation
-        fprintf(file, "%s", indentStr);
-        
-        char escapedKey[256];
-        escapeJSONString(child->key, escapedKey, sizeof(escapedKey));
-        
-        int keyCount = countSameKey(item->child, child->key);
-        int seenCount = 0;
-        ConfigItem *temp = item->child;
-        while (temp != child) {
-            if (strcmp(temp->key, child->key) == 0) seenCount++;
-            temp = temp->next;
-        }
+// Progress of an event parse whose input may arrive in pieces
+typedef struct EventParser {
+    const ConfigEvents *events;
+    void *context;
+    size_t depth;
+} EventParser;
 
-        // Write the key
-        fprintf(file, "\"%s\": ", escapedKey);
+// What one line of .v2 source is
+enum {
+    LINE_SKIP,
+    LINE_KEY_VALUE,
+    LINE_BEGIN_BLOCK,
+    LINE_END_BLOCK
+};
 
-        // Handle arrays (multiple elements with same key)
-        if (keyCount > 1 && seenCount == 0) {
-            fprintf(file, "[\n%s    ", indentStr);
-            int arrayFirst = 1;
-            
-            // Find all siblings with the same key
-            ConfigItem *sibling = child;
-            while (sibling && seenCount < keyCount) {
-                if (strcmp(sibling->key, child->key) == 0) {
-                    if (!arrayFirst) fprintf(file, ",\n%s    ", indentStr);
-                    arrayFirst = 0;
-                    
-                    if (sibling->child) {
-                        serializeJSON(sibling, file, indent + 1, checkDesign);
-                    }
-                    
-                    else if (sibling->value) {
-                        if (checkDesign) {
-                            // Intelligent value type detection for better JSON design
-                            if (isNumeric(sibling->value)) {
-                                fprintf(file, "%s", sibling->value);
-                            }
-                            
-                            else if (isBoolean(sibling->value)) {
-                                fprintf(file, "%s", sibling->value);
-                            }
-                            
-                            else if (isNull(sibling->value)) {
-                                fprintf(file, "null");
-                            }
-                            
-                            else {
-                                writeJSONString(file, sibling->value);
-                            }
-                        }
-                        
-                        else {
-                            writeJSONString(file, sibling->value);
-                        }
-                    }
-                    
-                    else {
-                        fprintf(file, "null");
-                    }
-                    seenCount++;
-                }
-                if (seenCount < keyCount) sibling = sibling->next;
-            }
-            
-            fprintf(file, "\n%s]", indentStr);
-            
-            // Skip all processed items
-            while (child && seenCount > 0) {
-                if (strcmp(child->key, escapedKey) == 0) seenCount--;
-                if (seenCount > 0) child = child->next;
-            }
-        }
-        
-        else {
-            // Handle single value
-            if (child->child) {
-                serializeJSON(child, file, indent + 1, checkDesign);
-            }
-            
-            else if (child->value) {
-                if (checkDesign) {
-                    // Intelligent value type detection for better JSON design
-                    if (isNumeric(child->value)) {
-                        fprintf(file, "%s", child->value);
-                    }
-                    
-                    else if (isBoolean(child->value)) {
-                        fprintf(file, "%s", child->value);
-                    }
-                    
-                    else if (isNull(child->value)) {
-                        fprintf(file, "null");
-                    }
-                    
-                    else {
-                        writeJSONString(file, child->value);
-                    }
-                }
-                
-                else {
-                    writeJSONString(file, child->value);
-                }
-            }
-            
-            else {
-                fprintf(file, "null");
-            }
-            child = child->next;
-        }
+// Function to classify one line (without its newline). Leading whitespace is
+// skipped in *line, and *mark is set to the '=' of a key/value or the '{' of
+// a block. Whether a line opens or closes a block never depends on the
+// lines around it.
+static inline int classifyLine(const char **line, const char *lineEnd, const char **mark) {
+    const char *start = *line;
+
+    // Skip comments and empty lines
+    if (start == lineEnd || start[0] == '#') return LINE_SKIP;
+
+    while (start < lineEnd && isspace((unsigned char)*start)) start++;
+    *line = start;
+    if (start == lineEnd) return LINE_SKIP;
+
+    const char *equals = (const char *)memchr(start, '=', (size_t)(lineEnd - start));
+    if (equals && equals > start && equals + 1 < lineEnd) {
+        *mark = equals;
+        return LINE_KEY_VALUE;
     }
-    
-    // Close the object with proper indentation
-    char closeIndentStr[128] = "";
-    for (int i = 0; i < indent; i++) {
-        strcat(closeIndentStr, "    ");
+
+    const char *brace = (const char *)memchr(start, '{', (size_t)(lineEnd - start));
+    if (brace && brace > start) {
+        *mark = brace;
+        return LINE_BEGIN_BLOCK;
     }
-    fprintf(file, "\n%s}", closeIndentStr);
+    return memchr(start, '}', (size_t)(lineEnd - start)) ? LINE_END_BLOCK : LINE_SKIP;
 }
 
-// Function to validate JSON structure
-int checkDesignJSON(const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Failed to open file %s for validation\n", filename);
-        return 0;
+// Function to find the end of the line at cursor; *next is where the one after starts
+static inline const char *lineBounds(const char *cursor, const char *end, const char **next) {
+    const char *lineEnd = (const char *)memchr(cursor, '\n', (size_t)(end - cursor));
+    if (lineEnd) {
+        *next = lineEnd + 1;
+        return lineEnd;
     }
-    
-    // Simple validation: check for balanced braces
-    int braceCount = 0;
-    int bracketCount = 0;
-    int inString = 0;
-    int escape = 0;
-    int error = 0;
-    int c;
-    
-    while ((c = fgetc(file)) != EOF && !error) {
-        if (escape) {
-            escape = 0;
-            continue;
-        }
-        
-        if (c == '\\' && inString) {
-            escape = 1;
-            continue;
+    *next = end;
+    return end;
+}
+
+// Function to parse whole lines of .v2 source (the last may lack its newline)
+static int parseEventLines(EventParser *parser, const char *data, size_t length) {
+    const ConfigEvents *events = parser->events;
+    void *context = parser->context;
+    const char *cursor = data;
+    const char *end = data + length;
+    while (cursor < end) {
+        const char *line = cursor;
+        const char *lineEnd = lineBounds(cursor, end, &cursor);
+        const char *mark = NULL;
+        int kind = classifyLine(&line, lineEnd, &mark);
+
+        if (kind == LINE_KEY_VALUE) {
+            const char *keyEnd = trimSliceEnd(line, mark);
+            if (!events->keyValue(context, line, (size_t)(keyEnd - line), mark + 1, (size_t)(lineEnd - mark - 1))) return 0;
         }
-        
-        if (c == '"' && !escape) {
-            inString = !inString;
-            continue;
+
+        else if (kind == LINE_BEGIN_BLOCK) {
+            const char *keyEnd = trimSliceEnd(line, mark);
+            if (!events->beginBlock(context, line, (size_t)(keyEnd - line))) return 0;
+            parser->depth++;
         }
-        
-        if (!inString) {
-            if (c == '{') braceCount++;
-            else if (c == '}') braceCount--;
-            else if (c == '[') bracketCount++;
-            else if (c == ']') bracketCount--;
-            
-            if (braceCount < 0 || bracketCount < 0) {
-                error = 1;
-                fprintf(stderr, "Error: Unbalanced braces or brackets in JSON\n");
+
+        else if (kind == LINE_END_BLOCK) {
+            if (parser->depth == 0) {
+                reportError("Syntax error: Unmatched closing brace\n");
+                return 0;
             }
+            if (!events->endBlock(context)) return 0;
+            parser->depth--;
         }
     }
-    
-    fclose(file);
-    
-    if (!error && (braceCount != 0 || bracketCount != 0)) {
-        fprintf(stderr, "Error: Unbalanced braces or brackets in JSON\n");
-        error = 1;
+    return 1;
+}
+
+// Function to close the blocks still open at the end of the input
+static int finishEvents(EventParser *parser) {
+    while (parser->depth > 0) {
+        if (!parser->events->endBlock(parser->context)) return 0;
+        parser->depth--;
     }
-    
-    return !error;
+    return 1;
 }
 
-// Function to validate YAML structure
-int checkDesignYAML(const char *filename) {
-    FILE *file = fopen(filename, "r");
+// Function to parse .v2 source held in memory in a single forward scan,
+// reporting begin-block, key/value and end-block events in document order.
+// Lines are classified exactly like parseV2Config does, without its line
+// and key/value length limits. Blocks still open at the end are closed.
+// Returns 1 on success.
+int parseV2Events(const char *data, size_t length, const ConfigEvents *events, void *context) {
+    EventParser parser = { events, context, 0 };
+    return parseEventLines(&parser, data, length) && finishEvents(&parser);
+}
+
+#define EVENT_CHUNK_SIZE (1024 * 1024)
+
+// Function to parse a .v2 file into events, reading it in fixed-size chunks
+// so memory use does not depend on the file's size (only on its longest line)
+int parseV2FileEvents(const char *filename, const ConfigEvents *events, void *context) {
+    FILE *file = fopen(filename, "rb");
     if (!file) {
-        fprintf(stderr, "Failed to open file %s for validation\n", filename);
+        reportError("Failed to open file %s\n", filename);
         return 0;
     }
-    
-    int error = 0;
-    int lineNum = 0;
-    char line[512];
-    int indentLevels[100] = {0}; // Track indentation at each level
-    int currentLevel = 0;
-    int inMultilineString = 0;
-    char stringDelimiter = 0; // ' or " for string delimiters
-    
-    // Check for common YAML errors
-    while (fgets(line, sizeof(line), file) && !error) {
-        lineNum++;
-        
-        // Skip empty lines and comments
-        if (line[0] == '\n' || line[0] == '#') continue;
-        
-        // Handle multiline strings
-        if (inMultilineString) {
-            for (char *p = line; *p; p++) {
-                if (*p == '\\' && *(p+1) == stringDelimiter) {
-                    p++; // Skip the escaped quote
-                    continue;
-                }
-                if (*p == stringDelimiter) {
-                    inMultilineString = 0;
-                    break;
-                }
+
+    EventParser parser = { events, context, 0 };
+    size_t capacity = EVENT_CHUNK_SIZE;
+    size_t used = 0;
+    char *buffer = (char *)malloc(capacity);
+    int ok = buffer != NULL;
+    if (!ok) reportError("Memory allocation failed\n");
+
+    while (ok) {
+        // A line longer than the buffer makes it grow
+        if (used == capacity) {
+            char *grown = (char *)realloc(buffer, capacity * 2);
+            if (!grown) {
+                reportError("Memory allocation failed\n");
+                ok = 0;
+                break;
             }
-            continue;
-        }
-        
-        // Count leading spaces for indentation
-        int indent = 0;
-        char *p = line;
-        while (*p == ' ') {
-            indent++;
-            p++;
+            buffer = grown;
+            capacity *= 2;
         }
-        
-        // Check for tab characters (not allowed in YAML)
-        if (strchr(line, '\t') != NULL) {
-            fprintf(stderr, "Error at line %d: Tab characters are not allowed in YAML\n", lineNum);
-            error = 1;
-            break;
-        }
-        
-        // Check for strings that might need quoting
-        if (strchr(line, ':') != NULL) {
-            char *key = line;
-            while (*key && *key != ':') key++;
-            
-            if (*key == ':' && *(key+1) != '\0' && *(key+1) != '\n') {
-                // Skip whitespace after colon
-                char *value = key + 1;
-                while (*value == ' ') value++;
-                
-                // Check if we're entering a multiline string
-                if (*value == '"' || *value == '\'') {
-                    stringDelimiter = *value;
-                    char *endQuote = strchr(value + 1, stringDelimiter);
-                    if (!endQuote || *(endQuote-1) == '\\') {
-                        inMultilineString = 1;
-                    }
-                }
-                
-                // Check for common illegal characters in unquoted values
-                if (*value != '"' && *value != '\'' && 
-                    (strchr(value, '{') || strchr(value, '}') || 
-                     strchr(value, '[') || strchr(value, ']') ||
-                     strchr(value, '&') || strchr(value, '*'))) {
-                    fprintf(stderr, "Warning at line %d: Value may need quotes: %s", lineNum, value);
-                }
+
+        size_t bytesRead = fread(buffer + used, 1, capacity - used, file);
+        if (bytesRead == 0) {
+            if (ferror(file)) {
+                reportError("Failed to read %s\n", filename);
+                ok = 0;
             }
+            break;
         }
-        
-        // Check indentation (must be consistent, typically multiples of 2)
-        if (indent % 2 != 0) {
-            fprintf(stderr, "Warning at line %d: Indent is not a multiple of 2 spaces\n", lineNum);
-        }
-        
-        // Determine current level based on indentation
-        int level = indent / 2;
-        
-        // Moving to a deeper level - store the new indent value
-        if (level > currentLevel) {
-            if (level != currentLevel + 1) {
-                fprintf(stderr, "Error at line %d: Indentation increased by more than one level\n", lineNum);
-                error = 1;
+        used += bytesRead;
+
+        // Parse up to the last complete line and keep the rest for the next read
+        char *lastNewline = NULL;
+        for (char *p = buffer + used; p > buffer; p--) {
+            if (p[-1] == '\n') {
+                lastNewline = p - 1;
                 break;
             }
-            indentLevels[level] = indent;
         }
-        // Check if we are at a consistent indentation for this level
-        else if (level > 0 && indent != indentLevels[level]) {
-            fprintf(stderr, "Error at line %d: Inconsistent indentation for this level\n", lineNum);
-            error = 1;
-            break;
+        if (lastNewline) {
+            size_t complete = (size_t)(lastNewline - buffer) + 1;
+            ok = parseEventLines(&parser, buffer, complete);
+            memmove(buffer, buffer + complete, used - complete);
+            used -= complete;
         }
-        
-        currentLevel = level;
     }
-    
+
+    if (ok) ok = parseEventLines(&parser, buffer, used) && finishEvents(&parser);
+    free(buffer);
     fclose(file);
-    
-    if (inMultilineString) {
-        fprintf(stderr, "Error: Unclosed string literal in YAML\n");
-        error = 1;
+    return ok;
+}
+
+// Event handlers that build a ConfigItem tree
+typedef struct TreeBuilder {
+    Arena *arena;
+    ConfigItem *current;
+    ConfigItem **stack;
+    size_t depth;
+    size_t capacity;
+} TreeBuilder;
+
+static int treeBeginBlock(void *context, const char *key, size_t keyLength) {
+    TreeBuilder *builder = (TreeBuilder *)context;
+    ConfigItem *item = createConfigItemSized(builder->arena, key, keyLength, NULL, 0);
+    if (!item) return 0;
+    addChild(builder->current, item);
+
+    if (builder->depth == builder->capacity) {
+        size_t newCapacity = builder->capacity ? builder->capacity * 2 : 64;
+        ConfigItem **grown = (ConfigItem **)realloc(builder->stack, newCapacity * sizeof(ConfigItem *));
+        if (!grown) {
+            reportError("Memory allocation failed\n");
+            return 0;
+        }
+        builder->stack = grown;
+        builder->capacity = newCapacity;
+    }
+    builder->stack[builder->depth++] = builder->current;
+    builder->current = item;
+    return 1;
+}
+
+static int treeKeyValue(void *context, const char *key, size_t keyLength, const char *value, size_t valueLength) {
+    TreeBuilder *builder = (TreeBuilder *)context;
+    ConfigItem *item = createConfigItemSized(builder->arena, key, keyLength, value, valueLength);
+    if (!item) return 0;
+    addChild(builder->current, item);
+    return 1;
+}
+
+static int treeEndBlock(void *context) {
+    TreeBuilder *builder = (TreeBuilder *)context;
+    builder->current = builder->stack[--builder->depth];
+    return 1;
+}
+
+static const ConfigEvents treeEvents = { treeBeginBlock, treeKeyValue, treeEndBlock };
+
+// Function to parse .v2 source held in memory into a ConfigItem tree
+ConfigItem *parseV2Buffer(const char *data, size_t length, Arena *arena) {
+    ConfigItem *root = createConfigItemSized(arena, "root", 4, NULL, 0);
+    if (!root) return NULL;
+
+    TreeBuilder builder = { arena, root, NULL, 0, 0 };
+    int parsed = parseV2Events(data, length, &treeEvents, &builder);
+    free(builder.stack);
+    if (!parsed) {
+        discardConfigItem(arena, root);
+        return NULL;
+    }
+    return root;
+}
+
+// Function to parse a .v2 configuration file through a memory mapping
+ConfigItem *parseV2ConfigMapped(const char *filename, Arena *arena) {
+    SourceBuffer source;
+    if (!openSourceBuffer(filename, &source)) {
+        reportError("Failed to open file %s\n", filename);
+        return NULL;
+    }
+
+    ConfigItem *root = parseV2Buffer(source.data, source.length, arena);
+    closeSourceBuffer(&source);
+    return root;
+}
+
+// Buffered output writer that hands data to its destination in large blocks.
+// The destination is a FILE (including stdout), a caller-supplied sink, or,
+// with neither, the growing in-memory buffer itself.
+typedef int (*WriterSink)(void *context, const char *data, size_t length);
+
+// A tap sees every block on its way to a file or sink (used for validation)
+typedef void (*WriterTap)(void *context, const char *data, size_t length);
+
+typedef struct OutputWriter {
+    char *buffer;
+    size_t length;
+    size_t capacity;
+    FILE *file;
+    WriterSink sink;
+    void *sinkContext;
+    WriterTap tap;
+    void *tapContext;
+    uint64_t sent;         // bytes handed to the file or sink so far
+    int failed;
+} OutputWriter;
+
+#define WRITER_BLOCK_SIZE (64 * 1024)
+
+static void writerSetup(OutputWriter *writer, FILE *file, WriterSink sink, void *context) {
+    // Memory writers start empty and grow on demand
+    writer->buffer = (file || sink) ? (char *)malloc(WRITER_BLOCK_SIZE) : NULL;
+    writer->length = 0;
+    writer->capacity = writer->buffer ? WRITER_BLOCK_SIZE : 0;
+    writer->file = file;
+    writer->sink = sink;
+    writer->sinkContext = context;
+    writer->tap = NULL;
+    writer->tapContext = NULL;
+    writer->sent = 0;
+    writer->failed = (file || sink) && writer->buffer == NULL;
+    if (writer->failed) {
+        fprintf(stderr, "Memory allocation failed\n");
+    }
+}
+
+// Function to create a writer that flushes to a FILE
+void writerInitFile(OutputWriter *writer, FILE *file) {
+    writerSetup(writer, file, NULL, NULL);
+}
+
+// Function to create a writer that flushes to a caller-supplied sink
+void writerInitSink(OutputWriter *writer, WriterSink sink, void *context) {
+    writerSetup(writer, NULL, sink, context);
+}
+
+// Function to create a writer that keeps everything in memory
+void writerInitMemory(OutputWriter *writer) {
+    writerSetup(writer, NULL, NULL, NULL);
+}
+
+// Function to attach a tap to a writer
+void writerSetTap(OutputWriter *writer, WriterTap tap, void *context) {
+    writer->tap = tap;
+    writer->tapContext = context;
+}
+
+// Hand a block of bytes straight to the destination
+static void writerSend(OutputWriter *writer, const char *data, size_t length) {
+    if (length == 0 || writer->failed) return;
+    if (writer->tap) writer->tap(writer->tapContext, data, length);
+    writer->sent += length;
+
+    if (writer->file) {
+        if (fwrite(data, 1, length, writer->file) != length) writer->failed = 1;
+    }
+    
+    else if (writer->sink) {
+        if (!writer->sink(writer->sinkContext, data, length)) writer->failed = 1;
+    }
+}
+
+// Function to push buffered output to the destination
+void writerFlush(OutputWriter *writer) {
+    if (!writer->file && !writer->sink) return;
+    writerSend(writer, writer->buffer, writer->length);
+    writer->length = 0;
+}
+
+// Make room for at least `needed` more bytes in a memory writer
+static int writerGrow(OutputWriter *writer, size_t needed) {
+    size_t capacity = writer->capacity ? writer->capacity : 256;
+    while (capacity - writer->length < needed) capacity *= 2;
+
+    char *grown = (char *)realloc(writer->buffer, capacity);
+    if (!grown) {
+        fprintf(stderr, "Memory allocation failed\n");
+        writer->failed = 1;
+        return 0;
+    }
+    writer->buffer = grown;
+    writer->capacity = capacity;
+    return 1;
+}
+
+// Function to append bytes to a writer
+void writerWrite(OutputWriter *writer, const char *data, size_t length) {
+    if (length == 0) return;
+    if (length <= writer->capacity - writer->length) {
+        memcpy(writer->buffer + writer->length, data, length);
+        writer->length += length;
+        return;
+    }
+
+    if (writer->file || writer->sink) {
+        writerFlush(writer);
+        if (length >= writer->capacity) {
+            writerSend(writer, data, length);
+            return;
+        }
+    }
+    
+    else if (!writerGrow(writer, length)) {
+        return;
+    }
+    memcpy(writer->buffer + writer->length, data, length);
+    writer->length += length;
+}
+
+// Function to append one character to a writer
+void writerPutChar(OutputWriter *writer, char c) {
+    if (writer->length == writer->capacity) {
+        writerWrite(writer, &c, 1);
+        return;
+    }
+    writer->buffer[writer->length++] = c;
+}
+
+// Function to append a NUL-terminated string to a writer
+void writerPutString(OutputWriter *writer, const char *str) {
+    writerWrite(writer, str, strlen(str));
+}
+
+// Function to append `count` spaces to a writer
+void writerPutSpaces(OutputWriter *writer, size_t count) {
+    static const char spaces[] = "                                                                ";
+    while (count > 0) {
+        size_t chunk = count < sizeof(spaces) - 1 ? count : sizeof(spaces) - 1;
+        writerWrite(writer, spaces, chunk);
+        count -= chunk;
+    }
+}
+
+// Function to flush and free a writer; returns 1 when every write succeeded
+int writerClose(OutputWriter *writer) {
+    writerFlush(writer);
+    free(writer->buffer);
+    writer->buffer = NULL;
+    writer->length = 0;
+    writer->capacity = 0;
+    return !writer->failed;
+}
+
+// Sink that collects everything in a memory writer (context), so taps still see it
+int writerSinkMemory(void *context, const char *data, size_t length) {
+    OutputWriter *memory = (OutputWriter *)context;
+    writerWrite(memory, data, length);
+    return !memory->failed;
+}
+
+// Background writer: sinks hand it blocks of output, and one thread writes
+// them to their files, so the thread producing the output does not wait on
+// the disk. At most ASYNC_MAX_QUEUED bytes wait at a time.
+#define ASYNC_MAX_QUEUED (16 * 1024 * 1024)
+
+typedef struct AsyncChunk {
+    struct AsyncChunk *next;
+    struct AsyncFile *target;
+    size_t length;
+    char data[];
+} AsyncChunk;
+
+typedef struct AsyncWriter {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    AsyncChunk *head;
+    AsyncChunk *tail;
+    size_t queued;
+    int stopping;
+} AsyncWriter;
+
+// One file written through an AsyncWriter (the sink context)
+typedef struct AsyncFile {
+    AsyncWriter *writer;
+    FILE *file;
+    int failed;            // set by the writer thread, under its lock
+} AsyncFile;
+
+static void *asyncWriterRun(void *arg) {
+    AsyncWriter *writer = (AsyncWriter *)arg;
+    pthread_mutex_lock(&writer->lock);
+    for (;;) {
+        while (!writer->head && !writer->stopping) pthread_cond_wait(&writer->changed, &writer->lock);
+        AsyncChunk *chunk = writer->head;
+        if (!chunk) break;
+        writer->head = chunk->next;
+        if (!writer->head) writer->tail = NULL;
+        int failed = chunk->target->failed;
+        pthread_mutex_unlock(&writer->lock);
+
+        if (!failed) failed = fwrite(chunk->data, 1, chunk->length, chunk->target->file) != chunk->length;
+
+        pthread_mutex_lock(&writer->lock);
+        if (failed) chunk->target->failed = 1;
+        writer->queued -= chunk->length;
+        pthread_cond_broadcast(&writer->changed);
+        free(chunk);
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+// Function to start a background writer; returns 0 if its thread cannot be started
+int asyncWriterStart(AsyncWriter *writer) {
+    writer->head = NULL;
+    writer->tail = NULL;
+    writer->queued = 0;
+    writer->stopping = 0;
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->changed, NULL);
+    if (pthread_create(&writer->thread, NULL, asyncWriterRun, writer) != 0) {
+        pthread_mutex_destroy(&writer->lock);
+        pthread_cond_destroy(&writer->changed);
+        return 0;
+    }
+    return 1;
+}
+
+// Function to wait until everything queued is written, then stop the thread
+void asyncWriterStop(AsyncWriter *writer) {
+    pthread_mutex_lock(&writer->lock);
+    writer->stopping = 1;
+    pthread_cond_broadcast(&writer->changed);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->changed);
+}
+
+// Sink that queues a copy of each block for the writer thread (context: an AsyncFile)
+int writerSinkAsync(void *context, const char *data, size_t length) {
+    AsyncFile *target = (AsyncFile *)context;
+    AsyncWriter *writer = target->writer;
+    AsyncChunk *chunk = (AsyncChunk *)malloc(sizeof(AsyncChunk) + length);
+    if (!chunk) {
+        reportError("Memory allocation failed\n");
+        return 0;
+    }
+    chunk->next = NULL;
+    chunk->target = target;
+    chunk->length = length;
+    memcpy(chunk->data, data, length);
+
+    pthread_mutex_lock(&writer->lock);
+    while (writer->queued > ASYNC_MAX_QUEUED) pthread_cond_wait(&writer->changed, &writer->lock);
+    if (writer->tail) writer->tail->next = chunk;
+    else writer->head = chunk;
+    writer->tail = chunk;
+    writer->queued += length;
+    int failed = target->failed;
+    pthread_cond_broadcast(&writer->changed);
+    pthread_mutex_unlock(&writer->lock);
+    return !failed;
+}
+
+// Bytes that cannot appear unescaped in a JSON string: '"', '\' and controls below 0x20
+static const unsigned char jsonEscapeTable[256] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0
+};
+
+// Length of the leading run of bytes that need no JSON escaping, one byte at a time
+static size_t jsonSafePrefixScalar(const char *str, size_t length) {
+    const unsigned char *bytes = (const unsigned char *)str;
+    size_t i = 0;
+    while (i < length && !jsonEscapeTable[bytes[i]]) i++;
+    return i;
+}
+
+#ifdef V2_X86_SIMD
+// Same scan, 16 bytes per step
+__attribute__((target("sse2")))
+static size_t jsonSafePrefixSSE2(const char *str, size_t length) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(str + i));
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                                    _mm_cmpeq_epi8(chunk, backslash)),
+                                       _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+        int mask = _mm_movemask_epi8(special);
+        if (mask) return i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+    return i + jsonSafePrefixScalar(str + i, length - i);
+}
+
+// Same scan, 32 bytes per step
+__attribute__((target("avx2")))
+static size_t jsonSafePrefixAVX2(const char *str, size_t length) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1f);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(str + i));
+        __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+                                                          _mm256_cmpeq_epi8(chunk, backslash)),
+                                          _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control), chunk));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(special);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+
+    // Finish with one 16-byte step here rather than calling the SSE2 kernel,
+    // to avoid mixing legacy SSE and VEX code
+    if (i + 16 <= length) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(str + i));
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(quote)),
+                                                    _mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(backslash))),
+                                       _mm_cmpeq_epi8(_mm_min_epu8(chunk, _mm256_castsi256_si128(control)), chunk));
+        int mask = _mm_movemask_epi8(special);
+        if (mask) return i + (size_t)__builtin_ctz((unsigned)mask);
+        i += 16;
+    }
+    return i + jsonSafePrefixScalar(str + i, length - i);
+}
+#endif
+
+// The scan kernel is picked for the running CPU on first use
+static size_t jsonSafePrefixResolve(const char *str, size_t length);
+static size_t (*jsonSafePrefix)(const char *str, size_t length) = jsonSafePrefixResolve;
+
+// Function to pick the escape scan kernel for the running CPU
+static void selectJSONEscapeKernel(void) {
+#ifdef V2_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        jsonSafePrefix = jsonSafePrefixAVX2;
+    }
+    
+    else if (__builtin_cpu_supports("sse2")) {
+        jsonSafePrefix = jsonSafePrefixSSE2;
+    }
+    
+    else
+#endif
+    {
+        jsonSafePrefix = jsonSafePrefixScalar;
+    }
+}
+
+static size_t jsonSafePrefixResolve(const char *str, size_t length) {
+    selectJSONEscapeKernel();
+    return jsonSafePrefix(str, length);
+}
+
+// Length of the leading safe run; short runs between escapes are checked
+// inline before handing longer ones to the vector kernel
+static inline size_t jsonSafeRun(const char *str, size_t length) {
+    const unsigned char *bytes = (const unsigned char *)str;
+    size_t limit = length < 8 ? length : 8;
+    size_t i = 0;
+    while (i < limit && !jsonEscapeTable[bytes[i]]) i++;
+    if (i < limit || i == length) return i;
+    return i + jsonSafePrefix(str + i, length - i);
+}
+
+// Function to build the escape sequence for one byte; returns its length
+static size_t jsonEscapeSequence(unsigned char c, char *sequence) {
+    static const char hex[] = "0123456789abcdef";
+    sequence[0] = '\\';
+    switch (c) {
+        case '"': sequence[1] = '"'; return 2;
+        case '\\': sequence[1] = '\\'; return 2;
+        case '\b': sequence[1] = 'b'; return 2;
+        case '\f': sequence[1] = 'f'; return 2;
+        case '\n': sequence[1] = 'n'; return 2;
+        case '\r': sequence[1] = 'r'; return 2;
+        case '\t': sequence[1] = 't'; return 2;
+        default:
+            sequence[1] = 'u';
+            sequence[2] = '0';
+            sequence[3] = '0';
+            sequence[4] = hex[c >> 4];
+            sequence[5] = hex[c & 0xf];
+            return 6;
+    }
+}
+
+// Status lines and diagnostics captured in order, tagged with their stream
+typedef struct Report {
+    OutputWriter log;
+} Report;
+
+static _Thread_local Report *activeReport = NULL;
+
+// Append one record to a captured report
+static void reportRecord(Report *report, char stream, const char *text, size_t size) {
+    writerPutChar(&report->log, stream);
+    writerWrite(&report->log, (const char *)&size, sizeof(size));
+    writerWrite(&report->log, text, size);
+}
+
+// Print one record, or capture it if this thread is redirected
+static void reportEmit(char stream, const char *text, size_t size) {
+    if (activeReport) {
+        reportRecord(activeReport, stream, text, size);
+    }
+    
+    else if (stream == 'E') {
+        fflush(stdout);
+        fwrite(text, 1, size, stderr);
+    }
+    
+    else {
+        fwrite(text, 1, size, stdout);
+    }
+}
+
+static void reportFormat(char stream, const char *format, va_list args) {
+    char buffer[512];
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    if (length > 0) {
+        size_t size = (size_t)length;
+        if (size < sizeof(buffer)) {
+            reportEmit(stream, buffer, size);
+        }
+        
+        else {
+            char *text = (char *)malloc(size + 1);
+            if (text) {
+                vsnprintf(text, size + 1, format, copy);
+                reportEmit(stream, text, size);
+                free(text);
+            }
+            
+            else {
+                reportEmit(stream, buffer, sizeof(buffer) - 1);
+            }
+        }
+    }
+    va_end(copy);
+}
+
+// Function to print a status line (to stdout, or the calling thread's report)
+void reportStatus(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    reportFormat('O', format, args);
+    va_end(args);
+}
+
+// Function to print a diagnostic (to stderr, or the calling thread's report)
+void reportError(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    reportFormat('E', format, args);
+    va_end(args);
+}
+
+// Function to route this thread's status lines and diagnostics into a report
+// (NULL to print them directly); returns the previous destination
+Report *reportRedirect(Report *report) {
+    Report *previous = activeReport;
+    activeReport = report;
+    return previous;
+}
+
+// Function to replay a captured report in its original order, to
+// stdout/stderr or into the report this thread is redirected to
+void reportReplay(Report *report) {
+    size_t pos = 0;
+    while (pos + 1 + sizeof(size_t) <= report->log.length) {
+        char stream = report->log.buffer[pos];
+        size_t size;
+        memcpy(&size, report->log.buffer + pos + 1, sizeof(size));
+        pos += 1 + sizeof(size);
+        reportEmit(stream, report->log.buffer + pos, size);
+        pos += size;
+    }
+    if (!activeReport) fflush(stdout);
+}
+
+// Function to append the text of every record in a captured report to a writer
+void reportCopyText(const Report *report, OutputWriter *out) {
+    size_t pos = 0;
+    while (pos + 1 + sizeof(size_t) <= report->log.length) {
+        size_t size;
+        memcpy(&size, report->log.buffer + pos + 1, sizeof(size));
+        pos += 1 + sizeof(size);
+        writerWrite(out, report->log.buffer + pos, size);
+        pos += size;
+    }
+}
+
+// Function to escape JSON strings
+void escapeJSONString(const char *input, char *output, size_t outSize) {
+    size_t length = strlen(input);
+    size_t pos = 0;
+    size_t outIndex = 0;
+
+    while (pos < length && outIndex < outSize - 1) {
+        // Copy the run of safe bytes in bulk, as much as fits
+        size_t safe = jsonSafeRun(input + pos, length - pos);
+        if (safe > outSize - 1 - outIndex) safe = outSize - 1 - outIndex;
+        memcpy(output + outIndex, input + pos, safe);
+        outIndex += safe;
+        pos += safe;
+        if (pos == length || outIndex == outSize - 1) break;
+
+        // Escapes that do not fit are dropped
+        char sequence[6];
+        size_t sequenceLength = jsonEscapeSequence((unsigned char)input[pos++], sequence);
+        if (outIndex + sequenceLength < outSize) {
+            memcpy(output + outIndex, sequence, sequenceLength);
+            outIndex += sequenceLength;
+        }
+    }
+    output[outIndex] = '\0';
+}
+
+// Count how many times a key appears in siblings
+int countSameKey(ConfigItem *start, const char *key) {
+    int count = 0;
+    while (start) {
+        if (strcmp(start->key, key) == 0) count++;
+        start = start->next;
+    }
+    return count;
+}
+
+// Function to append a JSON-escaped slice (without quotes) to a writer
+void writeJSONEscapedSized(OutputWriter *out, const char *str, size_t length) {
+    size_t pos = 0;
+    while (pos < length) {
+        size_t safe = jsonSafeRun(str + pos, length - pos);
+        writerWrite(out, str + pos, safe);
+        pos += safe;
+        if (pos == length) break;
+
+        char sequence[6];
+        writerWrite(out, sequence, jsonEscapeSequence((unsigned char)str[pos++], sequence));
+    }
+}
+
+// Function to append a JSON-escaped string (without quotes) to a writer
+void writeJSONEscaped(OutputWriter *out, const char *str) {
+    writeJSONEscapedSized(out, str, strlen(str));
+}
+
+// Function to append a quoted JSON string to a writer
+void writeJSONQuoted(OutputWriter *out, const char *str) {
+    writerPutChar(out, '"');
+    writeJSONEscaped(out, str);
+    writerPutChar(out, '"');
+}
+
+// Safely write a key or value to JSON
+void writeJSONString(FILE *file, const char *str) {
+    OutputWriter out;
+    writerInitFile(&out, file);
+    writeJSONQuoted(&out, str);
+    writerClose(&out);
+}
+
+// Function to determine value type for JSON
+int isNumeric(const char *str) {
+    if (!str) return 0;
+    char *endptr;
+    strtod(str, &endptr);
+    return *endptr == '\0';
+}
+
+int isBoolean(const char *str) {
+    if (!str) return 0;
+    return (strcmp(str, "true") == 0 || strcmp(str, "false") == 0);
+}
+
+int isNull(const char *str) {
+    if (!str) return 1;
+    return (strcmp(str, "null") == 0);
+}
+
+// Bytes that JSON must escape (VALUE_NEEDS_ESCAPE: '"', '\\' and controls) and that
+// make YAML quote a value (VALUE_NEEDS_QUOTES: spaces, controls, :#{}[]&*!|>'", and
+// bytes from 0x80, which the old signed-char test also caught)
+static const unsigned char valueByteFlags[256] = {
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    2, 2, 3, 2, 0, 0, 2, 2, 0, 0, 2, 0, 2, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 2, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 0, 0,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2
+};
+
+// Function to find which emitters have to rewrite a value, in one pass
+static uint8_t scanValueBytes(const char *value, size_t length) {
+    const unsigned char *bytes = (const unsigned char *)value;
+    unsigned flags = 0;
+    for (size_t i = 0; i < length && flags != (VALUE_NEEDS_ESCAPE | VALUE_NEEDS_QUOTES); i++) {
+        flags |= valueByteFlags[bytes[i]];
+    }
+    return (uint8_t)flags;
+}
+
+// Function to classify a value (NUL-terminated at length) the way checkDesign
+// reads it: a number is whatever strtod consumes whole, and true, false and
+// null must match exactly. Numbers that are only sign and digits are ints.
+static uint8_t classifyValue(const char *value, size_t length, uint8_t *flags) {
+    *flags = scanValueBytes(value, length);
+
+    // strtod takes an empty string whole; the value is still written as-is
+    if (length == 0) return VALUE_FLOAT;
+
+    // Sign and digits are always a number; strtod is only asked about the
+    // rest, and only when the first non-space byte can start one
+    const char *start = value;
+    while (isspace((unsigned char)*start)) start++;
+    const char *digits = start + (*start == '+' || *start == '-');
+    const char *end = digits;
+    while (isdigit((unsigned char)*end)) end++;
+    if (end > digits && *end == '\0') return VALUE_INT;
+    if (*start && strchr("+-.0123456789iInN", *start) && isNumeric(value)) return VALUE_FLOAT;
+
+    if (isBoolean(value)) return VALUE_BOOL;
+    if (isNull(value)) return VALUE_NULL;
+    return VALUE_STRING;
+}
+
+// Function to hash a key for the sibling key index
+static uint64_t hashKey(const char *key) {
+    uint64_t hash = 1469598103934665603ULL;
+    while (*key) {
+        hash ^= (unsigned char)*key++;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Function to continue an FNV-1a hash over more bytes
+static uint64_t hashBytes(uint64_t hash, const char *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static pthread_mutex_t internerOwnerLock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t internerOwners;
+
+// Function to double a key table
+static int growKeyInterner(KeyInterner *interner) {
+    size_t capacity = (interner->mask + 1) * 2;
+    InternedKey **slots = (InternedKey **)calloc(capacity, sizeof(InternedKey *));
+    if (!slots) return 0;
+    for (size_t i = 0; i <= interner->mask; i++) {
+        InternedKey *entry = interner->slots[i];
+        if (!entry) continue;
+        size_t slot = (size_t)entry->hash & (capacity - 1);
+        while (slots[slot]) slot = (slot + 1) & (capacity - 1);
+        slots[slot] = entry;
+    }
+    free(interner->slots);
+    interner->slots = slots;
+    interner->mask = capacity - 1;
+    return 1;
+}
+
+// Function to store a key (without NULs) once per arena, along with its hash
+// and escaped JSON form; returns the shared text, or NULL if the key should be
+// copied instead (out of memory, or the arena stopped interning)
+static char *internKey(Arena *arena, const char *key, size_t length) {
+    KeyInterner *interner = arena->interner;
+    if (!interner) {
+        interner = (KeyInterner *)malloc(sizeof(KeyInterner));
+        InternedKey **slots = (InternedKey **)calloc(64, sizeof(InternedKey *));
+        if (!interner || !slots) {
+            free(interner);
+            free(slots);
+            return NULL;
+        }
+        pthread_mutex_lock(&internerOwnerLock);
+        interner->owner = ++internerOwners;
+        pthread_mutex_unlock(&internerOwnerLock);
+        interner->slots = slots;
+        interner->mask = 63;
+        interner->count = 0;
+        interner->hits = 0;
+        interner->closed = 0;
+        arena->interner = interner;
+    }
+
+    uint64_t hash = hashBytes(1469598103934665603ULL, key, length);
+    size_t slot = (size_t)hash & interner->mask;
+    for (InternedKey *entry; (entry = interner->slots[slot]) != NULL; slot = (slot + 1) & interner->mask) {
+        if (entry->hash == hash && entry->length == length && memcmp(entry->text, key, length) == 0) {
+            interner->hits++;
+            return entry->text;
+        }
+    }
+
+    // Keep the table at most half full. When it is due to grow and most keys
+    // have been new (generated IDs, say), stop: sharing would save nothing.
+    if ((interner->count + 1) * 2 > interner->mask + 1) {
+        if (interner->count >= KEY_INTERN_SAMPLE && interner->hits < interner->count) {
+            interner->closed = 1;
+            return NULL;
+        }
+        if (!growKeyInterner(interner)) return NULL;
+        slot = (size_t)hash & interner->mask;
+        while (interner->slots[slot]) slot = (slot + 1) & interner->mask;
+    }
+
+    InternedKey *entry = (InternedKey *)arenaAlloc(arena, sizeof(InternedKey) + length + 1, _Alignof(InternedKey));
+    if (!entry) return NULL;
+    entry->owner = interner->owner;
+    entry->hash = hash;
+    entry->length = (uint32_t)length;
+    memcpy(entry->text, key, length);
+    entry->text[length] = '\0';
+    entry->json = NULL;
+    entry->jsonLength = (uint32_t)length;
+
+    size_t safe = jsonSafePrefix(key, length);
+    if (safe < length) {
+        char sequence[6];
+        size_t jsonLength = safe;
+        for (size_t i = safe; i < length; i++) {
+            unsigned char c = (unsigned char)key[i];
+            jsonLength += jsonEscapeTable[c] ? jsonEscapeSequence(c, sequence) : 1;
+        }
+        char *json = (char *)arenaAlloc(arena, jsonLength + 1, 1);
+        if (!json) return NULL;
+        memcpy(json, key, safe);
+        size_t out = safe;
+        for (size_t i = safe; i < length; i++) {
+            unsigned char c = (unsigned char)key[i];
+            if (jsonEscapeTable[c]) out += jsonEscapeSequence(c, json + out);
+            else json[out++] = (char)c;
+        }
+        json[out] = '\0';
+        entry->json = json;
+        entry->jsonLength = (uint32_t)jsonLength;
+    }
+
+    interner->slots[slot] = entry;
+    interner->count++;
+    return entry->text;
+}
+
+// Function to get the InternedKey behind a node's key, or NULL if it has its own copy
+static inline const InternedKey *internedKeyOf(const ConfigItem *item) {
+    return item->keyInterned ? (const InternedKey *)(item->key - offsetof(InternedKey, text)) : NULL;
+}
+
+// Function to get the length of a node's key
+static inline size_t itemKeyLength(const ConfigItem *item) {
+    const InternedKey *interned = internedKeyOf(item);
+    return interned ? interned->length : strlen(item->key);
+}
+
+// Function to write a node's key as a quoted JSON string, escaped once per document
+static void writeJSONKey(OutputWriter *out, const ConfigItem *item) {
+    const InternedKey *interned = internedKeyOf(item);
+    if (!interned) {
+        writeJSONQuoted(out, item->key);
+        return;
+    }
+    writerPutChar(out, '"');
+    writerWrite(out, interned->json ? interned->json : interned->text, interned->jsonLength);
+    writerPutChar(out, '"');
+}
+
+// Keys of one object's children, grouped so duplicate keys are found in linear time
+typedef struct KeyGroup {
+    const char *key;
+    const InternedKey *interned;   // NULL if the key is not interned
+    uint64_t hash;
+    int count;
+    int first;
+    int last;
+} KeyGroup;
+
+typedef struct KeyIndex {
+    ConfigItem **children;
+    uint32_t *nodes;   // for a compiled object, its children's node indices (same storage)
+    int *group;      // group of each child
+    int *rank;       // how many earlier siblings share the child's key
+    int *nextSame;   // next sibling with the same key, or -1
+    KeyGroup *groups;
+    int *slots;      // open-addressed hash table of group indices
+    int childCount;
+    int groupCount;
+    size_t slotMask;
+    void *block;
+} KeyIndex;
+
+// Function to find the group of a key, or -1
+static int findKeyGroup(const KeyIndex *index, const char *key, uint64_t hash) {
+    size_t slot = (size_t)hash & index->slotMask;
+    while (index->slots[slot] >= 0) {
+        const KeyGroup *group = &index->groups[index->slots[slot]];
+        if (group->hash == hash && strcmp(group->key, key) == 0) {
+            return index->slots[slot];
+        }
+        slot = (slot + 1) & index->slotMask;
+    }
+    return -1;
+}
+
+// Function to compare a group's key with a node's; keys interned by the same
+// table are equal only if they are the same copy
+static inline int keyGroupMatches(const KeyGroup *group, const char *key, const InternedKey *interned) {
+    if (group->interned && interned && group->interned->owner == interned->owner) {
+        return group->key == key;
+    }
+    return strcmp(group->key, key) == 0;
+}
+
+// Function to allocate a KeyIndex for count children
+static int allocKeyIndex(KeyIndex *index, int count) {
+    size_t slotCount = 16;
+    while (slotCount < (size_t)count * 2) slotCount <<= 1;
+
+    size_t size = (size_t)count * (sizeof(ConfigItem *) + 3 * sizeof(int) + sizeof(KeyGroup))
+                + slotCount * sizeof(int);
+    index->block = malloc(size);
+    if (!index->block) {
+        reportError("Memory allocation failed\n");
+        return 0;
+    }
+
+    index->groups = (KeyGroup *)index->block;
+    index->children = (ConfigItem **)(index->groups + count);
+    index->nodes = (uint32_t *)index->children;
+    index->group = (int *)(index->children + count);
+    index->rank = index->group + count;
+    index->nextSame = index->rank + count;
+    index->slots = index->nextSame + count;
+    index->childCount = count;
+    index->groupCount = 0;
+    index->slotMask = slotCount - 1;
+    memset(index->slots, 0xff, slotCount * sizeof(int));
+    return 1;
+}
+
+// Function to add the i-th child's key to a KeyIndex
+static void indexKey(KeyIndex *index, int i, const char *key, const InternedKey *interned) {
+    uint64_t hash = interned ? interned->hash : hashKey(key);
+    size_t slot = (size_t)hash & index->slotMask;
+    int groupIndex = -1;
+    while (index->slots[slot] >= 0) {
+        KeyGroup *group = &index->groups[index->slots[slot]];
+        if (group->hash == hash && keyGroupMatches(group, key, interned)) {
+            groupIndex = index->slots[slot];
+            break;
+        }
+        slot = (slot + 1) & index->slotMask;
+    }
+
+    if (groupIndex < 0) {
+        groupIndex = index->groupCount++;
+        KeyGroup *group = &index->groups[groupIndex];
+        group->key = key;
+        group->interned = interned;
+        group->hash = hash;
+        group->count = 0;
+        group->first = i;
+        index->slots[slot] = groupIndex;
+    }
+    
+    else {
+        index->nextSame[index->groups[groupIndex].last] = i;
+    }
+
+    KeyGroup *group = &index->groups[groupIndex];
+    index->group[i] = groupIndex;
+    index->rank[i] = group->count++;
+    index->nextSame[i] = -1;
+    group->last = i;
+}
+
+// Function to index the children of an object by key
+static int buildKeyIndex(KeyIndex *index, ConfigItem *item) {
+    int count = 0;
+    for (ConfigItem *child = item->child; child; child = child->next) count++;
+    if (!allocKeyIndex(index, count)) return 0;
+
+    int i = 0;
+    for (ConfigItem *child = item->child; child; child = child->next, i++) {
+        index->children[i] = child;
+        indexKey(index, i, child->key, internedKeyOf(child));
+    }
+    return 1;
+}
+
+// Function to find where an object's members continue after the array of
+// the group at position: the n-th sibling (from here on) whose key matches
+// the escaped key, n being the group's size. The caller re-emits that
+// sibling on its own, and runs off the end when no such sibling exists.
+static int resumeAfterGroup(const KeyIndex *index, int position, const char *key, const InternedKey *interned) {
+    int target = index->group[position];
+    size_t keyLength = interned ? interned->length : strlen(key);
+    if (interned && interned->json) {
+        target = findKeyGroup(index, interned->json, hashKey(interned->json));
+    }
+    
+    else if (!interned && jsonSafePrefix(key, keyLength) < keyLength) {
+        OutputWriter escaped;
+        writerInitMemory(&escaped);
+        writeJSONEscapedSized(&escaped, key, keyLength);
+        writerPutChar(&escaped, '\0');
+        target = escaped.failed ? -1 : findKeyGroup(index, escaped.buffer, hashKey(escaped.buffer));
+        writerClose(&escaped);
+    }
+
+    int next = index->childCount;
+    if (target >= 0) {
+        int j = index->groups[target].first;
+        while (j >= 0 && j < position) j = index->nextSame[j];
+        for (int remaining = index->groups[index->group[position]].count; j >= 0; j = index->nextSame[j]) {
+            if (--remaining == 0) {
+                next = j;
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+// How the JSON emitters write: JSON_TYPED (checkDesign) leaves numbers,
+// booleans and null unquoted, and JSON_COMPACT leaves out all whitespace
+#define JSON_TYPED 0x01
+#define JSON_COMPACT 0x02
+
+void serializeJSONToWriter(ConfigItem *item, OutputWriter *out, int indent, int style);
+
+// Function to start a new line at the given indentation, unless the JSON is compact
+static inline void writeJSONBreak(OutputWriter *out, size_t indent, int style) {
+    if (style & JSON_COMPACT) return;
+    writerPutChar(out, '\n');
+    writerPutSpaces(out, indent);
+}
+
+// Function to write the separator between a key and its value
+static inline void writeJSONColon(OutputWriter *out, int style) {
+    if (style & JSON_COMPACT) writerPutChar(out, ':');
+    else writerWrite(out, ": ", 2);
+}
+
+// Function to write a scalar value as JSON, typed with JSON_TYPED. Numbers,
+// booleans and null keep the text they were written with, less the
+// surrounding spaces in compact JSON.
+static void writeJSONScalar(const char *value, size_t length, uint8_t type, uint8_t flags, OutputWriter *out, int style) {
+    if ((style & JSON_TYPED) && type != VALUE_STRING) {
+        if (style & JSON_COMPACT) {
+            while (length > 0 && isspace((unsigned char)*value)) {
+                value++;
+                length--;
+            }
+            while (length > 0 && isspace((unsigned char)value[length - 1])) length--;
+        }
+        writerWrite(out, value, length);
+    }
+    
+    else if (flags & VALUE_NEEDS_ESCAPE) {
+        writerPutChar(out, '"');
+        writeJSONEscapedSized(out, value, length);
+        writerPutChar(out, '"');
+    }
+    
+    else {
+        writerPutChar(out, '"');
+        writerWrite(out, value, length);
+        writerPutChar(out, '"');
+    }
+}
+
+// Function to write a child's value (nested object, scalar, or null) as JSON
+static void writeJSONValue(ConfigItem *item, OutputWriter *out, int indent, int style) {
+    if (item->child) {
+        serializeJSONToWriter(item, out, indent + 1, style);
+    }
+    
+    else if (item->value) {
+        writeJSONScalar(item->value, item->valueLength, item->valueType, item->valueFlags, out, style);
+    }
+    
+    else {
+        writerWrite(out, "null", 4);
+    }
+}
+
+// Function to write an object's members as JSON, given its KeyIndex
+static void serializeJSONIndexed(const KeyIndex *index, OutputWriter *out, int indent, int style) {
+    writerPutChar(out, '{');
+    int first = 1;
+
+    // Indentation of this object's members
+    size_t memberIndent = (size_t)(indent + 1) * 4;
+
+    int position = 0;
+    while (position < index->childCount) {
+        ConfigItem *child = index->children[position];
+        if (!first) writerPutChar(out, ',');
+        first = 0;
+
+        // Write the key
+        writeJSONBreak(out, memberIndent, style);
+        writeJSONKey(out, child);
+        writeJSONColon(out, style);
+
+        const KeyGroup *group = &index->groups[index->group[position]];
+        int keyCount = group->count;
+
+        // Handle arrays (multiple elements with same key)
+        if (keyCount > 1 && index->rank[position] == 0) {
+            writerPutChar(out, '[');
+            
+            // Emit every sibling with the same key, in document order
+            for (int j = position; j >= 0; j = index->nextSame[j]) {
+                if (j != position) writerPutChar(out, ',');
+                writeJSONBreak(out, memberIndent + 4, style);
+                writeJSONValue(index->children[j], out, indent, style);
+            }
+            
+            writeJSONBreak(out, memberIndent, style);
+            writerPutChar(out, ']');
+            
+            // Continue after the array
+            position = resumeAfterGroup(index, position, child->key, internedKeyOf(child));
+        }
+        
+        else {
+            // Handle single value
+            writeJSONValue(child, out, indent, style);
+            position++;
+        }
+    }
+    
+    // Close the object with proper indentation
+    writeJSONBreak(out, (size_t)indent * 4, style);
+    writerPutChar(out, '}');
+}
+
+// JSON serialization (children only) with proper formatting, into a writer
+void serializeJSONToWriter(ConfigItem *item, OutputWriter *out, int indent, int style) {
+    if (!item || !item->child) {
+        writerWrite(out, "{}", 2);
+        return;
+    }
+
+    KeyIndex index;
+    if (!buildKeyIndex(&index, item)) {
+        out->failed = 1;
+        return;
+    }
+    serializeJSONIndexed(&index, out, indent, style);
+    free(index.block);
+}
+
+// JSON serialization (children only) with proper formatting
+void serializeJSON(ConfigItem *item, FILE *file, int indent, int style) {
+    OutputWriter out;
+    writerInitFile(&out, file);
+    serializeJSONToWriter(item, &out, indent, style);
+    writerClose(&out);
+}
+
+// Incremental JSON structure check (balanced braces and brackets outside strings),
+// fed the output as it is produced or a file as it is read
+typedef struct JSONValidator {
+    long braceCount;
+    long bracketCount;
+    int inString;
+    int escape;
+    int error;
+} JSONValidator;
+
+// Function to start a JSON structure check
+void jsonValidatorInit(JSONValidator *validator) {
+    validator->braceCount = 0;
+    validator->bracketCount = 0;
+    validator->inString = 0;
+    validator->escape = 0;
+    validator->error = 0;
+}
+
+// Function to feed the next chunk of JSON text to a check
+void jsonValidatorFeed(JSONValidator *validator, const char *data, size_t length) {
+    for (size_t i = 0; i < length && !validator->error; i++) {
+        char c = data[i];
+        if (validator->escape) {
+            validator->escape = 0;
+            continue;
+        }
+        
+        if (c == '\\' && validator->inString) {
+            validator->escape = 1;
+            continue;
+        }
+        
+        if (c == '"') {
+            validator->inString = !validator->inString;
+            continue;
+        }
+        
+        if (!validator->inString) {
+            if (c == '{') validator->braceCount++;
+            else if (c == '}') validator->braceCount--;
+            else if (c == '[') validator->bracketCount++;
+            else if (c == ']') validator->bracketCount--;
+            
+            if (validator->braceCount < 0 || validator->bracketCount < 0) {
+                validator->error = 1;
+                reportError("Error: Unbalanced braces or brackets in JSON\n");
+            }
+        }
+    }
+}
+
+// Function to finish a JSON structure check; returns 1 when the text is valid
+int jsonValidatorFinish(JSONValidator *validator) {
+    if (!validator->error && (validator->braceCount != 0 || validator->bracketCount != 0)) {
+        reportError("Error: Unbalanced braces or brackets in JSON\n");
+        validator->error = 1;
+    }
+    return !validator->error;
+}
+
+// Incremental YAML structure check, fed the output as it is produced or a
+// file as it is read; the text is checked one complete line at a time
+typedef struct YAMLValidator {
+    char *line;
+    size_t lineLength;
+    size_t lineCapacity;
+    int lineNum;
+    int *indentLevels;     // indentation at each level
+    int levelCapacity;
+    int currentLevel;
+    int inMultilineString;
+    char stringDelimiter;  // ' or " for string delimiters
+    int error;
+} YAMLValidator;
+
+// Function to start a YAML structure check
+void yamlValidatorInit(YAMLValidator *validator) {
+    memset(validator, 0, sizeof(*validator));
+}
+
+// Check one line (NUL-terminated, including its newline if it had one)
+static void yamlValidatorLine(YAMLValidator *validator, char *line) {
+    validator->lineNum++;
+    int lineNum = validator->lineNum;
+    
+    // Skip empty lines and comments
+    if (line[0] == '\n' || line[0] == '#') return;
+    
+    // Handle multiline strings
+    if (validator->inMultilineString) {
+        for (char *p = line; *p; p++) {
+            if (*p == '\\' && *(p+1) == validator->stringDelimiter) {
+                p++; // Skip the escaped quote
+                continue;
+            }
+            if (*p == validator->stringDelimiter) {
+                validator->inMultilineString = 0;
+                break;
+            }
+        }
+        return;
+    }
+    
+    // Count leading spaces for indentation
+    int indent = 0;
+    char *p = line;
+    while (*p == ' ') {
+        indent++;
+        p++;
+    }
+    
+    // Check for tab characters (not allowed in YAML)
+    if (strchr(line, '\t') != NULL) {
+        reportError("Error at line %d: Tab characters are not allowed in YAML\n", lineNum);
+        validator->error = 1;
+        return;
+    }
+    
+    // Check for strings that might need quoting
+    if (strchr(line, ':') != NULL) {
+        char *key = line;
+        while (*key && *key != ':') key++;
+        
+        if (*key == ':' && *(key+1) != '\0' && *(key+1) != '\n') {
+            // Skip whitespace after colon
+            char *value = key + 1;
+            while (*value == ' ') value++;
+            
+            // Check if we're entering a multiline string
+            if (*value == '"' || *value == '\'') {
+                validator->stringDelimiter = *value;
+                char *endQuote = strchr(value + 1, validator->stringDelimiter);
+                if (!endQuote || *(endQuote-1) == '\\') {
+                    validator->inMultilineString = 1;
+                }
+            }
+            
+            // Check for common illegal characters in unquoted values
+            if (*value != '"' && *value != '\'' && 
+                (strchr(value, '{') || strchr(value, '}') || 
+                 strchr(value, '[') || strchr(value, ']') ||
+                 strchr(value, '&') || strchr(value, '*'))) {
+                reportError("Warning at line %d: Value may need quotes: %s", lineNum, value);
+            }
+        }
+    }
+    
+    // Check indentation (must be consistent, typically multiples of 2)
+    if (indent % 2 != 0) {
+        reportError("Warning at line %d: Indent is not a multiple of 2 spaces\n", lineNum);
+    }
+    
+    // Determine current level based on indentation
+    int level = indent / 2;
+    
+    // Moving to a deeper level - store the new indent value
+    if (level > validator->currentLevel) {
+        if (level != validator->currentLevel + 1) {
+            reportError("Error at line %d: Indentation increased by more than one level\n", lineNum);
+            validator->error = 1;
+            return;
+        }
+        if (level >= validator->levelCapacity) {
+            int newCapacity = validator->levelCapacity ? validator->levelCapacity * 2 : 64;
+            int *grown = (int *)realloc(validator->indentLevels, (size_t)newCapacity * sizeof(int));
+            if (!grown) {
+                reportError("Memory allocation failed\n");
+                validator->error = 1;
+                return;
+            }
+            memset(grown + validator->levelCapacity, 0, (size_t)(newCapacity - validator->levelCapacity) * sizeof(int));
+            validator->indentLevels = grown;
+            validator->levelCapacity = newCapacity;
+        }
+        validator->indentLevels[level] = indent;
+    }
+    // Check if we are at a consistent indentation for this level
+    else if (level > 0 && indent != validator->indentLevels[level]) {
+        reportError("Error at line %d: Inconsistent indentation for this level\n", lineNum);
+        validator->error = 1;
+        return;
+    }
+    
+    validator->currentLevel = level;
+}
+
+// Append text to the pending line, keeping it NUL-terminated
+static int yamlValidatorAppend(YAMLValidator *validator, const char *data, size_t length) {
+    if (validator->lineLength + length + 1 > validator->lineCapacity) {
+        size_t newCapacity = validator->lineCapacity ? validator->lineCapacity : 512;
+        while (newCapacity < validator->lineLength + length + 1) newCapacity *= 2;
+        char *grown = (char *)realloc(validator->line, newCapacity);
+        if (!grown) {
+            reportError("Memory allocation failed\n");
+            validator->error = 1;
+            return 0;
+        }
+        validator->line = grown;
+        validator->lineCapacity = newCapacity;
+    }
+    memcpy(validator->line + validator->lineLength, data, length);
+    validator->lineLength += length;
+    validator->line[validator->lineLength] = '\0';
+    return 1;
+}
+
+// Function to feed the next chunk of YAML text to a check
+void yamlValidatorFeed(YAMLValidator *validator, const char *data, size_t length) {
+    const char *end = data + length;
+    while (data < end && !validator->error) {
+        const char *newline = (const char *)memchr(data, '\n', (size_t)(end - data));
+        size_t chunk = newline ? (size_t)(newline - data) + 1 : (size_t)(end - data);
+        if (!yamlValidatorAppend(validator, data, chunk)) return;
+        data += chunk;
+
+        if (newline) {
+            yamlValidatorLine(validator, validator->line);
+            validator->lineLength = 0;
+        }
+    }
+}
+
+// Function to finish a YAML structure check; returns 1 when the text is valid
+int yamlValidatorFinish(YAMLValidator *validator) {
+    if (!validator->error && validator->lineLength > 0) {
+        yamlValidatorLine(validator, validator->line);
+        validator->lineLength = 0;
+    }
+    
+    if (validator->inMultilineString) {
+        reportError("Error: Unclosed string literal in YAML\n");
+        validator->error = 1;
+    }
+
+    free(validator->line);
+    free(validator->indentLevels);
+    validator->line = NULL;
+    validator->indentLevels = NULL;
+    validator->lineCapacity = 0;
+    validator->levelCapacity = 0;
+    return !validator->error;
+}
+
+// Writer taps that run the checks on serializer output as it is flushed
+static void jsonValidatorTap(void *context, const char *data, size_t length) {
+    jsonValidatorFeed((JSONValidator *)context, data, length);
+}
+
+static void yamlValidatorTap(void *context, const char *data, size_t length) {
+    yamlValidatorFeed((YAMLValidator *)context, data, length);
+}
+
+// Read a file in large blocks and hand each one to a check
+static int feedFile(const char *filename, void (*feed)(void *context, const char *data, size_t length), void *context) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        reportError("Failed to open file %s for validation\n", filename);
+        return 0;
+    }
+
+    char *block = (char *)malloc(WRITER_BLOCK_SIZE);
+    if (!block) {
+        fclose(file);
+        reportError("Memory allocation failed\n");
+        return 0;
+    }
+
+    size_t bytesRead;
+    while ((bytesRead = fread(block, 1, WRITER_BLOCK_SIZE, file)) > 0) {
+        feed(context, block, bytesRead);
+    }
+    free(block);
+    fclose(file);
+    return 1;
+}
+
+// Function to validate JSON structure
+int checkDesignJSON(const char *filename) {
+    JSONValidator validator;
+    jsonValidatorInit(&validator);
+    if (!feedFile(filename, jsonValidatorTap, &validator)) return 0;
+    return jsonValidatorFinish(&validator);
+}
+
+// Function to validate YAML structure
+int checkDesignYAML(const char *filename) {
+    YAMLValidator validator;
+    yamlValidatorInit(&validator);
+    if (!feedFile(filename, yamlValidatorTap, &validator)) {
+        yamlValidatorFinish(&validator);
+        return 0;
+    }
+    return yamlValidatorFinish(&validator);
+}
+
+// Function to write ": value" and the newline after a YAML key
+static void writeYAMLScalar(const char *value, size_t length, uint8_t flags, OutputWriter *out) {
+    // For YAML, we need to properly quote strings with special characters
+    if (flags & VALUE_NEEDS_QUOTES) {
+        writerWrite(out, ": \"", 3);
+        // Escape double quotes in the value
+        const char *run = value;
+        const char *end = value + length;
+        const char *quote;
+        while ((quote = (const char *)memchr(run, '"', (size_t)(end - run))) != NULL) {
+            writerWrite(out, run, (size_t)(quote - run));
+            writerWrite(out, "\\\"", 2);
+            run = quote + 1;
+        }
+        writerWrite(out, run, (size_t)(end - run));
+        writerWrite(out, "\"\n", 2);
+    }
+    
+    else {
+        writerWrite(out, ": ", 2);
+        writerWrite(out, value, length);
+        writerPutChar(out, '\n');
+    }
+}
+
+// Function to serialize a ConfigItem to YAML, into a writer
+void serializeYAMLToWriter(ConfigItem *item, OutputWriter *out, int indent) {
+    if (!item) return;
+
+    ConfigItem *child = item->child;
+    while (child) {
+        writerPutSpaces(out, (size_t)indent * 2);
+        writerWrite(out, child->key, itemKeyLength(child));
+        
+        if (child->value) {
+            writeYAMLScalar(child->value, child->valueLength, child->valueFlags, out);
+        }
+        
+        else {
+            writerWrite(out, ":\n", 2);
+            serializeYAMLToWriter(child, out, indent + 1);
+        }
+        child = child->next;
+    }
+}
+
+// Function to serialize a ConfigItem to YAML
+void serializeYAML(ConfigItem *item, FILE *file, int indent) {
+    OutputWriter out;
+    writerInitFile(&out, file);
+    serializeYAMLToWriter(item, &out, indent);
+    writerClose(&out);
+}
+
+// Binary serialization: MessagePack and CBOR. Both hold the document the JSON
+// emitter writes: objects become maps, repeated keys become one array, and
+// the members come in the same order. When typed, the values checkDesign
+// types become integers, doubles, booleans and null; every other value is a
+// string of the bytes as written. Both formats require strings to be UTF-8,
+// so keys and values that are not are written as byte strings instead.
+enum {
+    BINARY_MSGPACK,
+    BINARY_CBOR
+};
+
+// What a binary header introduces
+enum {
+    BINARY_MAP,
+    BINARY_ARRAY,
+    BINARY_STRING,
+    BINARY_BYTES
+};
+
+// Function to write the low bytes of an integer, most significant first
+static void writeBigEndian(OutputWriter *out, uint64_t value, int bytes) {
+    char buffer[8];
+    for (int i = bytes - 1; i >= 0; i--) {
+        buffer[i] = (char)(value & 0xff);
+        value >>= 8;
+    }
+    writerWrite(out, buffer, (size_t)bytes);
+}
+
+// Function to write a CBOR head: a major type with its argument in the
+// fewest bytes
+static void writeCBORHead(OutputWriter *out, unsigned major, uint64_t argument) {
+    unsigned char initial = (unsigned char)(major << 5);
+    if (argument < 24) {
+        writerPutChar(out, (char)(initial | argument));
+    }
+
+    else if (argument <= 0xff) {
+        writerPutChar(out, (char)(initial | 24));
+        writeBigEndian(out, argument, 1);
+    }
+
+    else if (argument <= 0xffff) {
+        writerPutChar(out, (char)(initial | 25));
+        writeBigEndian(out, argument, 2);
+    }
+
+    else if (argument <= 0xffffffffu) {
+        writerPutChar(out, (char)(initial | 26));
+        writeBigEndian(out, argument, 4);
+    }
+
+    else {
+        writerPutChar(out, (char)(initial | 27));
+        writeBigEndian(out, argument, 8);
+    }
+}
+
+// Function to write the header of a map (length in members), array (in
+// elements) or text or byte string (in bytes)
+static void writeBinaryHead(OutputWriter *out, int encoding, int kind, uint64_t length) {
+    static const unsigned cborMajor[] = { 5, 4, 3, 2 };
+    // MessagePack: fixmap, fixarray and fixstr, then 16- and 32-bit lengths
+    // (strings and bin also have an 8-bit one; bin has no fixed form)
+    static const unsigned char fixed[] = { 0x80, 0x90, 0xa0, 0 };
+    static const uint64_t fixedLimit[] = { 16, 16, 32, 0 };
+    static const unsigned char sized8[] = { 0, 0, 0xd9, 0xc4 };
+    static const unsigned char sized16[] = { 0xde, 0xdc, 0xda, 0xc5 };
+    static const unsigned char sized32[] = { 0xdf, 0xdd, 0xdb, 0xc6 };
+
+    if (encoding == BINARY_CBOR) {
+        writeCBORHead(out, cborMajor[kind], length);
+    }
+
+    else if (length < fixedLimit[kind]) {
+        writerPutChar(out, (char)(fixed[kind] | length));
+    }
+
+    else if (sized8[kind] && length <= 0xff) {
+        writerPutChar(out, (char)sized8[kind]);
+        writeBigEndian(out, length, 1);
+    }
+
+    else if (length <= 0xffff) {
+        writerPutChar(out, (char)sized16[kind]);
+        writeBigEndian(out, length, 2);
+    }
+
+    else {
+        writerPutChar(out, (char)sized32[kind]);
+        writeBigEndian(out, length, 4);
+    }
+}
+
+// Function to check that text is well-formed UTF-8: no stray continuation
+// bytes, overlong forms, surrogates or code points past U+10FFFF
+static int isValidUTF8(const char *text, size_t length) {
+    const unsigned char *bytes = (const unsigned char *)text;
+    size_t i = 0;
+    while (i < length) {
+        unsigned char lead = bytes[i];
+        if (lead < 0x80) {
+            i++;
+            continue;
+        }
+
+        // Continuation bytes, and the range the first of them must fall in
+        size_t count;
+        unsigned char low = 0x80;
+        unsigned char high = 0xbf;
+        if (lead >= 0xc2 && lead <= 0xdf) {
+            count = 1;
+        }
+
+        else if (lead >= 0xe0 && lead <= 0xef) {
+            count = 2;
+            if (lead == 0xe0) low = 0xa0;
+            if (lead == 0xed) high = 0x9f;
+        }
+
+        else if (lead >= 0xf0 && lead <= 0xf4) {
+            count = 3;
+            if (lead == 0xf0) low = 0x90;
+            if (lead == 0xf4) high = 0x8f;
+        }
+
+        else {
+            return 0;
+        }
+
+        if (length - i <= count || bytes[i + 1] < low || bytes[i + 1] > high) return 0;
+        for (size_t k = 2; k <= count; k++) {
+            if ((bytes[i + k] & 0xc0) != 0x80) return 0;
+        }
+        i += count + 1;
+    }
+    return 1;
+}
+
+// Function to write a key or string value: as a text string when it is
+// UTF-8, and otherwise as a byte string
+static void writeBinaryText(OutputWriter *out, int encoding, const char *text, size_t length) {
+    writeBinaryHead(out, encoding, isValidUTF8(text, length) ? BINARY_STRING : BINARY_BYTES, length);
+    writerWrite(out, text, length);
+}
+
+// Function to write an integer, given as its sign and magnitude, in the
+// fewest bytes
+static void writeBinaryInteger(OutputWriter *out, int encoding, int negative, uint64_t magnitude) {
+    if (encoding == BINARY_CBOR) {
+        if (negative) writeCBORHead(out, 1, magnitude - 1);
+        else writeCBORHead(out, 0, magnitude);
+        return;
+    }
+
+    // MessagePack: positive and negative fixints, then uint 8 to 64 (0xcc to
+    // 0xcf) or int 8 to 64 (0xd0 to 0xd3), whichever is smallest
+    static const uint64_t unsignedLimits[] = { 0xff, 0xffff, 0xffffffffu };
+    static const uint64_t negativeLimits[] = { 0x80, 0x8000, 0x80000000u };
+    uint64_t bits = negative ? 0 - magnitude : magnitude;
+    if ((!negative && magnitude < 0x80) || (negative && magnitude <= 32)) {
+        writerPutChar(out, (char)bits);
+        return;
+    }
+
+    const uint64_t *limits = negative ? negativeLimits : unsignedLimits;
+    int width = 0;
+    while (width < 3 && magnitude > limits[width]) width++;
+    writerPutChar(out, (char)((negative ? 0xd0 : 0xcc) + width));
+    writeBigEndian(out, bits, 1 << width);
+}
+
+// Function to write a double, as a single-precision float when that holds it exactly
+static void writeBinaryDouble(OutputWriter *out, int encoding, double value) {
+    if (value >= -FLT_MAX && value <= FLT_MAX && (double)(float)value == value) {
+        float single = (float)value;
+        uint32_t bits;
+        memcpy(&bits, &single, sizeof(bits));
+        writerPutChar(out, encoding == BINARY_CBOR ? (char)0xfa : (char)0xca);
+        writeBigEndian(out, bits, 4);
+    }
+
+    else {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        writerPutChar(out, encoding == BINARY_CBOR ? (char)0xfb : (char)0xcb);
+        writeBigEndian(out, bits, 8);
+    }
+}
+
+// Function to read an integer the way classifyValue found it (spaces, a sign
+// and digits) as its sign and magnitude; returns 0 if it needs more than 64 bits
+static int parseBinaryInteger(const char *value, int *negative, uint64_t *magnitude) {
+    while (isspace((unsigned char)*value)) value++;
+    *negative = *value == '-';
+    if (*value == '+' || *value == '-') value++;
+
+    uint64_t result = 0;
+    for (; isdigit((unsigned char)*value); value++) {
+        unsigned digit = (unsigned)(*value - '0');
+        if (result > (UINT64_MAX - digit) / 10) return 0;
+        result = result * 10 + digit;
+    }
+    if (result == 0) *negative = 0;
+    *magnitude = result;
+    return 1;
+}
+
+// Function to write a scalar value (NUL-terminated at length), typed when typed is set
+static void writeBinaryScalar(const char *value, size_t length, uint8_t type, OutputWriter *out, int encoding, int typed) {
+    int negative;
+    uint64_t magnitude;
+
+    // An empty value counts as a number for checkDesign, but there is no number to write
+    if (!typed || type == VALUE_STRING || length == 0) {
+        writeBinaryText(out, encoding, value, length);
+    }
+
+    // MessagePack's integers stop at -2^63; CBOR's go down to -2^64
+    else if (type == VALUE_INT && parseBinaryInteger(value, &negative, &magnitude) &&
+             (!negative || encoding == BINARY_CBOR || magnitude <= (uint64_t)1 << 63)) {
+        writeBinaryInteger(out, encoding, negative, magnitude);
+    }
+
+    else if (type == VALUE_INT || type == VALUE_FLOAT) {
+        writeBinaryDouble(out, encoding, strtod(value, NULL));
+    }
+
+    else if (type == VALUE_BOOL && encoding == BINARY_CBOR) {
+        writerPutChar(out, value[0] == 't' ? (char)0xf5 : (char)0xf4);
+    }
+
+    else if (type == VALUE_BOOL) {
+        writerPutChar(out, value[0] == 't' ? (char)0xc3 : (char)0xc2);
+    }
+
+    else {
+        writerPutChar(out, encoding == BINARY_CBOR ? (char)0xf6 : (char)0xc0);
+    }
+}
+
+// Function to find the member that follows the one at position, in the
+// order serializeJSONToWriter writes an object's members
+static int nextObjectMember(const KeyIndex *index, int position) {
+    if (index->groups[index->group[position]].count > 1 && index->rank[position] == 0) {
+        ConfigItem *child = index->children[position];
+        return resumeAfterGroup(index, position, child->key, internedKeyOf(child));
+    }
+    return position + 1;
+}
+
+void serializeBinaryToWriter(ConfigItem *item, OutputWriter *out, int encoding, int typed);
+
+// Function to write a child's value (nested map, scalar, or null) in a binary encoding
+static void writeBinaryValue(ConfigItem *item, OutputWriter *out, int encoding, int typed) {
+    if (item->child) {
+        serializeBinaryToWriter(item, out, encoding, typed);
+    }
+
+    else if (item->value) {
+        writeBinaryScalar(item->value, item->valueLength, item->valueType, out, encoding, typed);
+    }
+
+    else {
+        writerPutChar(out, encoding == BINARY_CBOR ? (char)0xf6 : (char)0xc0);
+    }
+}
+
+// Function to serialize a ConfigItem's children as a MessagePack or CBOR
+// map (BINARY_*), into a writer
+void serializeBinaryToWriter(ConfigItem *item, OutputWriter *out, int encoding, int typed) {
+    if (!item || !item->child) {
+        writeBinaryHead(out, encoding, BINARY_MAP, 0);
+        return;
+    }
+
+    KeyIndex index;
+    if (!buildKeyIndex(&index, item)) {
+        out->failed = 1;
+        return;
+    }
+
+    // A map starts with its size, so the members are counted first
+    uint64_t members = 0;
+    for (int position = 0; position < index.childCount; position = nextObjectMember(&index, position)) {
+        members++;
+    }
+    writeBinaryHead(out, encoding, BINARY_MAP, members);
+
+    for (int position = 0; position < index.childCount; position = nextObjectMember(&index, position)) {
+        ConfigItem *child = index.children[position];
+        writeBinaryText(out, encoding, child->key, itemKeyLength(child));
+
+        const KeyGroup *group = &index.groups[index.group[position]];
+        if (group->count > 1 && index.rank[position] == 0) {
+            writeBinaryHead(out, encoding, BINARY_ARRAY, (uint64_t)group->count);
+            for (int j = position; j >= 0; j = index.nextSame[j]) {
+                writeBinaryValue(index.children[j], out, encoding, typed);
+            }
+        }
+
+        else {
+            writeBinaryValue(child, out, encoding, typed);
+        }
+    }
+    free(index.block);
+}
+
+// Streaming emitters for --parser::stream: JSON and YAML written straight from
+// parser events, so memory stays flat however large the input is. JSON groups
+// repeated keys of an object into an array, which needs the whole object, so
+// a first pass (scanDuplicateKeys) lists the blocks that repeat a key; only
+// those are collected into a tree and emitted with serializeJSONToWriter.
+
+// Set of key hashes seen in one open block
+typedef struct KeySet {
+    uint64_t *slots;
+    size_t capacity;
+    size_t count;
+} KeySet;
+
+// Function to add a hash to a set; returns 1 if it was already there, -1 if out of memory
+static int keySetInsert(KeySet *set, uint64_t hash) {
+    if (hash == 0) hash = 1;
+    if ((set->count + 1) * 2 > set->capacity) {
+        size_t capacity = set->capacity ? set->capacity * 2 : 16;
+        uint64_t *slots = (uint64_t *)calloc(capacity, sizeof(uint64_t));
+        if (!slots) {
+            reportError("Memory allocation failed\n");
+            return -1;
+        }
+        for (size_t i = 0; i < set->capacity; i++) {
+            if (!set->slots[i]) continue;
+            size_t slot = (size_t)set->slots[i] & (capacity - 1);
+            while (slots[slot]) slot = (slot + 1) & (capacity - 1);
+            slots[slot] = set->slots[i];
+        }
+        free(set->slots);
+        set->slots = slots;
+        set->capacity = capacity;
+    }
+
+    size_t slot = (size_t)hash & (set->capacity - 1);
+    while (set->slots[slot]) {
+        if (set->slots[slot] == hash) return 1;
+        slot = (slot + 1) & (set->capacity - 1);
+    }
+    set->slots[slot] = hash;
+    set->count++;
+    return 0;
+}
+
+// Function to empty a set, dropping its table if it grew for a much wider block
+static void keySetClear(KeySet *set) {
+    if (set->capacity > 1024) {
+        free(set->slots);
+        set->slots = NULL;
+        set->capacity = 0;
+    }
+    
+    else if (set->count) {
+        memset(set->slots, 0, set->capacity * sizeof(uint64_t));
+    }
+    set->count = 0;
+}
+
+// First pass: the ordinals (root = 0, then blocks in order of appearance) of
+// blocks with a repeated key. Hash collisions only cost a needless fallback.
+typedef struct DuplicateScan {
+    struct {
+        KeySet keys;
+        uint32_t ordinal;
+        int found;
+    } *levels;
+    size_t depth;
+    size_t capacity;
+    uint32_t ordinal;
+    uint32_t *found;
+    size_t foundCount;
+    size_t foundCapacity;
+} DuplicateScan;
+
+static int scanKey(DuplicateScan *scan, const char *key, size_t keyLength) {
+    keyLength = strnlen(key, keyLength);
+    int seen = keySetInsert(&scan->levels[scan->depth].keys, hashBytes(1469598103934665603ULL, key, keyLength));
+    if (seen < 0) return 0;
+    if (seen && !scan->levels[scan->depth].found) {
+        if (scan->foundCount == scan->foundCapacity) {
+            size_t newCapacity = scan->foundCapacity ? scan->foundCapacity * 2 : 16;
+            uint32_t *grown = (uint32_t *)realloc(scan->found, newCapacity * sizeof(uint32_t));
+            if (!grown) {
+                reportError("Memory allocation failed\n");
+                return 0;
+            }
+            scan->found = grown;
+            scan->foundCapacity = newCapacity;
+        }
+        scan->found[scan->foundCount++] = scan->levels[scan->depth].ordinal;
+        scan->levels[scan->depth].found = 1;
+    }
+    return 1;
+}
+
+static int scanBeginBlock(void *context, const char *key, size_t keyLength) {
+    DuplicateScan *scan = (DuplicateScan *)context;
+    if (!scanKey(scan, key, keyLength)) return 0;
+
+    if (scan->depth + 1 == scan->capacity) {
+        size_t newCapacity = scan->capacity * 2;
+        void *grown = realloc(scan->levels, newCapacity * sizeof(*scan->levels));
+        if (!grown) {
+            reportError("Memory allocation failed\n");
+            return 0;
+        }
+        scan->levels = grown;
+        memset(scan->levels + scan->capacity, 0, (newCapacity - scan->capacity) * sizeof(*scan->levels));
+        scan->capacity = newCapacity;
+    }
+    scan->depth++;
+    keySetClear(&scan->levels[scan->depth].keys);
+    scan->levels[scan->depth].ordinal = ++scan->ordinal;
+    scan->levels[scan->depth].found = 0;
+    return 1;
+}
+
+static int scanKeyValue(void *context, const char *key, size_t keyLength, const char *value, size_t valueLength) {
+    (void)value;
+    (void)valueLength;
+    return scanKey((DuplicateScan *)context, key, keyLength);
+}
+
+static int scanEndBlock(void *context) {
+    ((DuplicateScan *)context)->depth--;
+    return 1;
+}
+
+static int compareOrdinals(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Function to check a .v2 file and list, in order, the blocks that repeat a key.
+// Returns 0 (after reporting why) if the file does not parse.
+int scanDuplicateKeys(const char *filename, uint32_t **duplicates, size_t *count) {
+    static const ConfigEvents scanEvents = { scanBeginBlock, scanKeyValue, scanEndBlock };
+    DuplicateScan scan;
+    memset(&scan, 0, sizeof(scan));
+    scan.capacity = 64;
+    scan.levels = calloc(scan.capacity, sizeof(*scan.levels));
+    if (!scan.levels) {
+        reportError("Memory allocation failed\n");
+        return 0;
+    }
+
+    int parsed = parseV2FileEvents(filename, &scanEvents, &scan);
+    for (size_t i = 0; i < scan.capacity; i++) {
+        free(scan.levels[i].keys.slots);
+    }
+    free(scan.levels);
+
+    if (!parsed) {
+        free(scan.found);
+        return 0;
+    }
+    if (scan.foundCount > 1) qsort(scan.found, scan.foundCount, sizeof(uint32_t), compareOrdinals);
+    *duplicates = scan.found;
+    *count = scan.foundCount;
+    return 1;
+}
+
+// Second pass state for JSON
+typedef struct JSONStream {
+    OutputWriter *out;
+    int style;                 // JSON_*
+    size_t depth;              // depth of the innermost open block (root = 0)
+    int opened;                // whether that block has written its '{' yet
+    uint32_t ordinal;
+    const uint32_t *duplicates;
+    size_t duplicateCount;
+    size_t nextDuplicate;
+    char *scratch;             // the current value, NUL-terminated
+    size_t scratchCapacity;
+
+    // A block that repeats a key is collected here and emitted whole
+    int collecting;
+    size_t collectDepth;
+    ConfigItem *collected;
+    Arena arena;
+    TreeBuilder builder;
+} JSONStream;
+
+// Function to copy a slice into the scratch buffer as a C string
+static const char *streamScratch(char **scratch, size_t *capacity, const char *data, size_t length) {
+    if (length + 1 > *capacity) {
+        size_t newCapacity = *capacity ? *capacity : 256;
+        while (newCapacity < length + 1) newCapacity *= 2;
+        char *grown = (char *)realloc(*scratch, newCapacity);
+        if (!grown) {
+            reportError("Memory allocation failed\n");
+            return NULL;
+        }
+        *scratch = grown;
+        *capacity = newCapacity;
+    }
+    memcpy(*scratch, data, length);
+    (*scratch)[length] = '\0';
+    return *scratch;
+}
+
+// Start collecting a block (or the root) that has a repeated key
+static int jsonStreamCollect(JSONStream *stream, const char *key, size_t keyLength) {
+    stream->collected = createConfigItemSized(&stream->arena, key, keyLength, NULL, 0);
+    if (!stream->collected) return 0;
+    stream->builder.arena = &stream->arena;
+    stream->builder.current = stream->collected;
+    stream->builder.depth = 0;
+    stream->collecting = 1;
+    stream->collectDepth = 0;
+    return 1;
+}
+
+// Start a member of the innermost open block: separator, indentation and key
+static void jsonStreamMember(JSONStream *stream, const char *key, size_t keyLength) {
+    OutputWriter *out = stream->out;
+    writerPutChar(out, stream->opened ? ',' : '{');
+    stream->opened = 1;
+    writeJSONBreak(out, (stream->depth + 1) * 4, stream->style);
+    writerPutChar(out, '"');
+    writeJSONEscapedSized(out, key, strnlen(key, keyLength));
+    writerPutChar(out, '"');
+    writeJSONColon(out, stream->style);
+}
+
+static int jsonStreamBeginBlock(void *context, const char *key, size_t keyLength) {
+    JSONStream *stream = (JSONStream *)context;
+    stream->ordinal++;
+    while (stream->nextDuplicate < stream->duplicateCount && stream->duplicates[stream->nextDuplicate] < stream->ordinal) {
+        stream->nextDuplicate++;
+    }
+
+    if (stream->collecting) {
+        stream->collectDepth++;
+        return treeBeginBlock(&stream->builder, key, keyLength);
+    }
+
+    jsonStreamMember(stream, key, keyLength);
+    if (stream->nextDuplicate < stream->duplicateCount && stream->duplicates[stream->nextDuplicate] == stream->ordinal) {
+        return jsonStreamCollect(stream, key, keyLength);
+    }
+    stream->depth++;
+    stream->opened = 0;
+    return 1;
+}
+
+static int jsonStreamKeyValue(void *context, const char *key, size_t keyLength, const char *value, size_t valueLength) {
+    JSONStream *stream = (JSONStream *)context;
+    if (stream->collecting) {
+        return treeKeyValue(&stream->builder, key, keyLength, value, valueLength);
+    }
+
+    jsonStreamMember(stream, key, keyLength);
+    // Nothing keeps this value, so it is classified here instead of in a node
+    valueLength = strnlen(value, valueLength);
+    const char *scalar = streamScratch(&stream->scratch, &stream->scratchCapacity, value, valueLength);
+    if (!scalar) return 0;
+    uint8_t flags;
+    uint8_t type = classifyValue(scalar, valueLength, &flags);
+    writeJSONScalar(scalar, valueLength, type, flags, stream->out, stream->style);
+    return !stream->out->failed;
+}
+
+static int jsonStreamEndBlock(void *context) {
+    JSONStream *stream = (JSONStream *)context;
+    if (stream->collecting) {
+        if (stream->collectDepth > 0) {
+            stream->collectDepth--;
+            return treeEndBlock(&stream->builder);
+        }
+
+        // The collected block is complete: emit it as its parent's member
+        writeJSONValue(stream->collected, stream->out, (int)stream->depth, stream->style);
+        arenaRelease(&stream->arena);
+        arenaInit(&stream->arena);
+        stream->collecting = 0;
+        return !stream->out->failed;
+    }
+
+    // Like the tree emitter, a block with no members is null
+    if (stream->opened) {
+        writeJSONBreak(stream->out, stream->depth * 4, stream->style);
+        writerPutChar(stream->out, '}');
+    }
+    
+    else {
+        writerWrite(stream->out, "null", 4);
+    }
+    stream->depth--;
+    stream->opened = 1;
+    return !stream->out->failed;
+}
+
+// Function to write a .v2 file as JSON straight from parser events, given the
+// blocks scanDuplicateKeys found; the output matches serializeJSONToWriter
+int streamJSON(const char *filename, const uint32_t *duplicates, size_t duplicateCount, OutputWriter *out, int style) {
+    static const ConfigEvents jsonEvents = { jsonStreamBeginBlock, jsonStreamKeyValue, jsonStreamEndBlock };
+    JSONStream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.out = out;
+    stream.style = style;
+    stream.duplicates = duplicates;
+    stream.duplicateCount = duplicateCount;
+    arenaInit(&stream.arena);
+
+    int ok = 1;
+    if (duplicateCount > 0 && duplicates[0] == 0) {
+        ok = jsonStreamCollect(&stream, "root", 4);
+        stream.nextDuplicate = 1;
+    }
+    if (ok) ok = parseV2FileEvents(filename, &jsonEvents, &stream);
+
+    if (ok && stream.collecting) {
+        serializeJSONToWriter(stream.collected, out, 0, style);
+    }
+    
+    else if (ok && stream.opened) {
+        writeJSONBreak(out, 0, style);
+        writerPutChar(out, '}');
+    }
+    
+    else if (ok) {
+        writerWrite(out, "{}", 2);
+    }
+
+    free(stream.builder.stack);
+    free(stream.scratch);
+    arenaRelease(&stream.arena);
+    if (!ok) out->failed = 1;
+    return ok && !out->failed;
+}
+
+// Second pass state for YAML, which needs nothing but the depth
+typedef struct YAMLStream {
+    OutputWriter *out;
+    size_t depth;
+} YAMLStream;
+
+static int yamlStreamBeginBlock(void *context, const char *key, size_t keyLength) {
+    YAMLStream *stream = (YAMLStream *)context;
+    writerPutSpaces(stream->out, stream->depth * 2);
+    writerWrite(stream->out, key, strnlen(key, keyLength));
+    writerWrite(stream->out, ":\n", 2);
+    stream->depth++;
+    return !stream->out->failed;
+}
+
+static int yamlStreamKeyValue(void *context, const char *key, size_t keyLength, const char *value, size_t valueLength) {
+    YAMLStream *stream = (YAMLStream *)context;
+    writerPutSpaces(stream->out, stream->depth * 2);
+    writerWrite(stream->out, key, strnlen(key, keyLength));
+    valueLength = strnlen(value, valueLength);
+    writeYAMLScalar(value, valueLength, scanValueBytes(value, valueLength), stream->out);
+    return !stream->out->failed;
+}
+
+static int yamlStreamEndBlock(void *context) {
+    ((YAMLStream *)context)->depth--;
+    return 1;
+}
+
+// Function to write a .v2 file as YAML straight from parser events; the
+// output matches serializeYAMLToWriter
+int streamYAML(const char *filename, OutputWriter *out) {
+    static const ConfigEvents yamlEvents = { yamlStreamBeginBlock, yamlStreamKeyValue, yamlStreamEndBlock };
+    YAMLStream stream = { out, 0 };
+    if (!parseV2FileEvents(filename, &yamlEvents, &stream)) out->failed = 1;
+    return !out->failed;
+}
+
+// Fan-out emitters: one walk of a tree, in document order, writes several
+// formats at once. A format whose order inside a block differs from the
+// document's (JSON groups repeated keys) writes that whole block from enter
+// and returns 0; the walk then skips the block's members for that format.
+typedef struct FanOutFormat {
+    int (*enter)(void *state, ConfigItem *block, int depth);     // the root has depth 0
+    void (*scalar)(void *state, ConfigItem *item, int depth);
+    void (*leave)(void *state, ConfigItem *block, int depth);
+} FanOutFormat;
+
+typedef struct FanOutTarget {
+    const FanOutFormat *format;
+    void *state;
+} FanOutTarget;
+
+#define FANOUT_MAX_TARGETS 32
+
+// Walk the members of a block for the targets in `active` (one bit each)
+static void fanOutBlock(ConfigItem *block, int depth, const FanOutTarget *targets, size_t count, uint32_t active) {
+    for (ConfigItem *child = block->child; child; child = child->next) {
+        if (child->value) {
+            for (size_t t = 0; t < count; t++) {
+                if (active >> t & 1) targets[t].format->scalar(targets[t].state, child, depth + 1);
+            }
+            continue;
+        }
+
+        uint32_t inner = 0;
+        for (size_t t = 0; t < count; t++) {
+            if ((active >> t & 1) && targets[t].format->enter(targets[t].state, child, depth + 1)) inner |= 1u << t;
+        }
+        if (inner && child->child) fanOutBlock(child, depth + 1, targets, count, inner);
+        for (size_t t = 0; t < count; t++) {
+            if (inner >> t & 1) targets[t].format->leave(targets[t].state, child, depth + 1);
+        }
+    }
+}
+
+// Function to write a tree in up to FANOUT_MAX_TARGETS formats with one walk
+void emitFanOut(ConfigItem *root, const FanOutTarget *targets, size_t count) {
+    uint32_t active = 0;
+    for (size_t t = 0; t < count && t < FANOUT_MAX_TARGETS; t++) {
+        if (targets[t].format->enter(targets[t].state, root, 0)) active |= 1u << t;
+    }
+    if (active && root->child) fanOutBlock(root, 0, targets, count, active);
+    for (size_t t = 0; t < count && t < FANOUT_MAX_TARGETS; t++) {
+        if (active >> t & 1) targets[t].format->leave(targets[t].state, root, 0);
+    }
+}
+
+// JSON as a fan-out format; the output matches serializeJSONToWriter
+typedef struct JSONFanOut {
+    OutputWriter *out;
+    int style;             // JSON_*
+    int opened;            // whether the innermost open block has written its '{'
+} JSONFanOut;
+
+// Blocks with up to this many members are checked for a repeated key by
+// comparing each key with the ones before it, without building a KeyIndex
+#define FANOUT_SMALL_BLOCK 8
+
+// Function to compare two nodes' keys; keys interned by the same table are
+// equal only if they are the same copy
+static inline int sameItemKey(const ConfigItem *a, const ConfigItem *b) {
+    const InternedKey *internedA = internedKeyOf(a);
+    const InternedKey *internedB = internedKeyOf(b);
+    if (internedA && internedB && internedA->owner == internedB->owner) return a->key == b->key;
+    return strcmp(a->key, b->key) == 0;
+}
+
+// Function to tell whether a block repeats a key; -1 if that cannot be
+// worked out. When it had to index a larger block that does repeat one, the
+// index is left in index (*indexed set) for writing the block.
+static int blockRepeatsKey(ConfigItem *block, KeyIndex *index, int *indexed) {
+    *indexed = 0;
+    if (!block->child || !block->child->next) return 0;
+
+    int count = 0;
+    for (ConfigItem *child = block->child; child && count <= FANOUT_SMALL_BLOCK; child = child->next) count++;
+    if (count <= FANOUT_SMALL_BLOCK) {
+        for (ConfigItem *child = block->child->next; child; child = child->next) {
+            for (ConfigItem *earlier = block->child; earlier != child; earlier = earlier->next) {
+                if (sameItemKey(earlier, child)) return 1;
+            }
+        }
+        return 0;
+    }
+
+    if (!buildKeyIndex(index, block)) return -1;
+    if (index->groupCount < index->childCount) {
+        *indexed = 1;
+        return 1;
+    }
+    free(index->block);
+    return 0;
+}
+
+// Start a member of the innermost open block: separator, indentation and key
+static void jsonFanOutMember(JSONFanOut *json, ConfigItem *item, int depth) {
+    writerPutChar(json->out, json->opened ? ',' : '{');
+    json->opened = 1;
+    writeJSONBreak(json->out, (size_t)depth * 4, json->style);
+    writeJSONKey(json->out, item);
+    writeJSONColon(json->out, json->style);
+}
+
+static int jsonFanOutEnter(void *state, ConfigItem *block, int depth) {
+    JSONFanOut *json = (JSONFanOut *)state;
+    if (depth > 0) jsonFanOutMember(json, block, depth);
+
+    // A block with arrays is written whole, in the order of its key groups
+    KeyIndex index;
+    int indexed;
+    int repeats = blockRepeatsKey(block, &index, &indexed);
+    if (repeats < 0) {
+        json->out->failed = 1;
+        return 0;
+    }
+    if (repeats) {
+        if (indexed) serializeJSONIndexed(&index, json->out, depth, json->style);
+        else serializeJSONToWriter(block, json->out, depth, json->style);
+        if (indexed) free(index.block);
+        json->opened = 1;
+        return 0;
+    }
+    json->opened = 0;
+    return 1;
+}
+
+static void jsonFanOutScalar(void *state, ConfigItem *item, int depth) {
+    JSONFanOut *json = (JSONFanOut *)state;
+    jsonFanOutMember(json, item, depth);
+    writeJSONScalar(item->value, item->valueLength, item->valueType, item->valueFlags, json->out, json->style);
+}
+
+static void jsonFanOutLeave(void *state, ConfigItem *block, int depth) {
+    JSONFanOut *json = (JSONFanOut *)state;
+    (void)block;
+    if (json->opened) {
+        writeJSONBreak(json->out, (size_t)depth * 4, json->style);
+        writerPutChar(json->out, '}');
+    }
+
+    // Like serializeJSONToWriter, an empty block is null and an empty root {}
+    else if (depth > 0) {
+        writerWrite(json->out, "null", 4);
+    }
+
+    else {
+        writerWrite(json->out, "{}", 2);
+    }
+    json->opened = 1;
+}
+
+const FanOutFormat jsonFanOut = { jsonFanOutEnter, jsonFanOutScalar, jsonFanOutLeave };
+
+// YAML as a fan-out format; the output matches serializeYAMLToWriter
+static int yamlFanOutEnter(void *state, ConfigItem *block, int depth) {
+    OutputWriter *out = (OutputWriter *)state;
+    if (depth > 0) {
+        writerPutSpaces(out, (size_t)(depth - 1) * 2);
+        writerWrite(out, block->key, itemKeyLength(block));
+        writerWrite(out, ":\n", 2);
+    }
+    return 1;
+}
+
+static void yamlFanOutScalar(void *state, ConfigItem *item, int depth) {
+    OutputWriter *out = (OutputWriter *)state;
+    writerPutSpaces(out, (size_t)(depth - 1) * 2);
+    writerWrite(out, item->key, itemKeyLength(item));
+    writeYAMLScalar(item->value, item->valueLength, item->valueFlags, out);
+}
+
+static void yamlFanOutLeave(void *state, ConfigItem *block, int depth) {
+    (void)state;
+    (void)block;
+    (void)depth;
+}
+
+const FanOutFormat yamlFanOut = { yamlFanOutEnter, yamlFanOutScalar, yamlFanOutLeave };
+
+// Function to remove file extension and add new extension
+void changeFileExtension(const char *input, char *output, const char *newExt) {
+    strcpy(output, input);
+    char *dot = strrchr(output, '.');
+    if (dot) {
+        strcpy(dot, newExt);
+    }
+    
+    else {
+        strcat(output, newExt);
+    }
+}
+
+// Function to interpret the configuration file
+void interpretConfig(ConfigItem *item, int indent) {
+    if (!item) return;
+
+    ConfigItem *child = item->child;
+    while (child) {
+        for (int i = 0; i < indent; ++i) printf("  ");
+        if (child->value) {
+            printf("%s = %s\n", child->key, child->value);
+        }
+        
+        else {
+            printf("%s:\n", child->key);
+            interpretConfig(child, indent + 1);
+        }
+        child = child->next;
+    }
+}
+
+// Compiled (.v2c) configuration format: a header, a flat array of nodes in
+// document order and a string table. A node's subtree is the index range
+// [index, end), so its first child is index + 1 and the sibling after a
+// child c is nodes[c].end. Strings are NUL-terminated and referenced by
+// offset, so a mapped file can be read in place.
+#define COMPILED_VERSION 1
+#define COMPILED_NO_VALUE UINT64_MAX
+
+static const char compiledMagic[4] = { '\x89', 'V', '2', 'C' };
+
+typedef struct CompiledHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;    // 0x01020304 as written by the compiling machine
+    uint32_t nodeCount;
+    uint64_t stringsSize;
+    uint64_t reserved;
+} CompiledHeader;
+
+typedef struct CompiledNode {
+    uint64_t key;          // offset of the key in the string table
+    uint64_t value;        // offset of the value, or COMPILED_NO_VALUE for blocks
+    uint32_t keyLength;
+    uint32_t valueLength;
+    uint32_t end;          // one past the last node of this subtree
+    uint32_t flags;        // 0 in files; COMPILED_TYPED in flattenConfig's output
+} CompiledNode;
+
+// Set in memory by flattenConfig: flags also hold valueType | valueFlags << 8
+#define COMPILED_TYPED 0x80000000u
+
+// A compiled configuration mapped into memory
+typedef struct CompiledConfig {
+    SourceBuffer source;
+    const CompiledNode *nodes;
+    const char *strings;
+    uint32_t nodeCount;
+    uint64_t stringsSize;
+} CompiledConfig;
+
+// Function to tell whether a buffer holds a compiled configuration
+int isCompiledConfig(const char *data, size_t length) {
+    return length >= sizeof(compiledMagic) && memcmp(data, compiledMagic, sizeof(compiledMagic)) == 0;
+}
+
+// Function to write a ConfigItem tree in the compiled format to a writer;
+// with typed, each node's flags also record its value's type (see COMPILED_TYPED)
+static int compileNodesToWriter(ConfigItem *root, OutputWriter *out, int typed) {
+    typedef struct OpenBlock {
+        ConfigItem *item;
+        uint32_t index;
+    } OpenBlock;
+
+    size_t capacity = 256;
+    size_t stackCapacity = 64;
+    CompiledNode *nodes = (CompiledNode *)malloc(capacity * sizeof(CompiledNode));
+    ConfigItem **items = (ConfigItem **)malloc(capacity * sizeof(ConfigItem *));
+    OpenBlock *stack = (OpenBlock *)malloc(stackCapacity * sizeof(OpenBlock));
+    size_t count = 0;
+    size_t depth = 0;
+    uint64_t offset = 0;
+    int ok = nodes && items && stack;
+
+    // Preorder walk: record a node, then go down to its first child, or on to
+    // the next sibling of the nearest open block, closing finished blocks
+    for (ConfigItem *item = root; ok && item; ) {
+        if (count == capacity || count == UINT32_MAX) {
+            CompiledNode *grownNodes = count < UINT32_MAX ? (CompiledNode *)realloc(nodes, capacity * 2 * sizeof(CompiledNode)) : NULL;
+            if (grownNodes) nodes = grownNodes;
+            ConfigItem **grownItems = grownNodes ? (ConfigItem **)realloc(items, capacity * 2 * sizeof(ConfigItem *)) : NULL;
+            if (grownItems) items = grownItems;
+            if (!grownNodes || !grownItems) {
+                ok = 0;
+                break;
+            }
+            capacity *= 2;
+        }
+
+        CompiledNode *node = &nodes[count];
+        size_t keyLength = itemKeyLength(item);
+        size_t valueLength = item->valueLength;
+        if (keyLength >= UINT32_MAX || valueLength >= UINT32_MAX) {
+            ok = 0;
+            break;
+        }
+        node->key = offset;
+        node->keyLength = (uint32_t)keyLength;
+        offset += keyLength + 1;
+        if (item->value) {
+            node->value = offset;
+            node->valueLength = (uint32_t)valueLength;
+            offset += valueLength + 1;
+        }
+        
+        else {
+            node->value = COMPILED_NO_VALUE;
+            node->valueLength = 0;
+        }
+        node->flags = typed ? COMPILED_TYPED | item->valueType | (uint32_t)item->valueFlags << 8 : 0;
+        items[count++] = item;
+
+        if (item->child) {
+            if (depth == stackCapacity) {
+                OpenBlock *grown = (OpenBlock *)realloc(stack, stackCapacity * 2 * sizeof(OpenBlock));
+                if (!grown) {
+                    ok = 0;
+                    break;
+                }
+                stack = grown;
+                stackCapacity *= 2;
+            }
+            stack[depth].item = item;
+            stack[depth].index = (uint32_t)(count - 1);
+            depth++;
+            item = item->child;
+            continue;
+        }
+
+        node->end = (uint32_t)count;
+        for (;;) {
+            if (depth == 0) {
+                item = NULL;
+                break;
+            }
+            if (item->next) {
+                item = item->next;
+                break;
+            }
+            depth--;
+            nodes[stack[depth].index].end = (uint32_t)count;
+            item = stack[depth].item;
+        }
+    }
+    free(stack);
+
+    if (!ok) {
+        free(nodes);
+        free(items);
+        reportError("Memory allocation failed\n");
+        return 0;
+    }
+
+    CompiledHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, compiledMagic, sizeof(compiledMagic));
+    header.version = COMPILED_VERSION;
+    header.byteOrder = 0x01020304;
+    header.nodeCount = (uint32_t)count;
+    header.stringsSize = offset;
+
+    writerWrite(out, (const char *)&header, sizeof(header));
+    writerWrite(out, (const char *)nodes, count * sizeof(CompiledNode));
+
+    // The string table, in the same order as the offsets above
+    for (size_t i = 0; i < count; i++) {
+        writerWrite(out, items[i]->key, (size_t)nodes[i].keyLength + 1);
+        if (items[i]->value) writerWrite(out, items[i]->value, (size_t)nodes[i].valueLength + 1);
+    }
+    free(nodes);
+    free(items);
+    return !out->failed;
+}
+
+// Function to write a ConfigItem tree in the compiled format to a writer
+int compileConfigToWriter(ConfigItem *root, OutputWriter *out) {
+    return compileNodesToWriter(root, out, 0);
+}
+
+// Function to write a ConfigItem tree in the compiled format
+int compileConfig(ConfigItem *root, FILE *file) {
+    OutputWriter out;
+    writerInitFile(&out, file);
+    int ok = compileConfigToWriter(root, &out);
+    return writerClose(&out) && ok;
+}
+
+// Check that a string reference lies inside the table and is NUL-terminated there
+static int compiledStringValid(const CompiledConfig *config, uint64_t offset, uint32_t length) {
+    return offset < config->stringsSize && length < config->stringsSize - offset &&
+           config->strings[offset + length] == '\0';
+}
+
+// Function to check the compiled configuration held in config->source and
+// set up the views into it; returns 0 if it is malformed
+int loadCompiledConfig(CompiledConfig *config) {
+    const char *data = config->source.data;
+    size_t length = config->source.length;
+    CompiledHeader header;
+
+    if (length < sizeof(header) || !isCompiledConfig(data, length)) return 0;
+    memcpy(&header, data, sizeof(header));
+    if (header.version != COMPILED_VERSION || header.byteOrder != 0x01020304 || header.nodeCount == 0) return 0;
+    if ((length - sizeof(header)) / sizeof(CompiledNode) < header.nodeCount) return 0;
+
+    size_t nodesSize = (size_t)header.nodeCount * sizeof(CompiledNode);
+    if (header.stringsSize != length - sizeof(header) - nodesSize) return 0;
+
+    config->nodes = (const CompiledNode *)(data + sizeof(header));
+    config->strings = data + sizeof(header) + nodesSize;
+    config->nodeCount = header.nodeCount;
+    config->stringsSize = header.stringsSize;
+
+    // Every subtree must split exactly into its children's subtrees; a valid
+    // file takes nodeCount - 1 steps in total, so stop early on anything more
+    uint32_t count = header.nodeCount;
+    uint64_t steps = 0;
+    if (config->nodes[0].end != count) return 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const CompiledNode *node = &config->nodes[i];
+        if (node->flags != 0 || !compiledStringValid(config, node->key, node->keyLength)) return 0;
+        if (node->value != COMPILED_NO_VALUE) {
+            if (!compiledStringValid(config, node->value, node->valueLength) || node->end != i + 1) return 0;
+        }
+        if (node->end <= i || node->end > count) return 0;
+
+        for (uint32_t child = i + 1; child < node->end; child = config->nodes[child].end) {
+            if (++steps >= count) return 0;
+            if (config->nodes[child].end <= child || config->nodes[child].end > node->end) return 0;
+        }
+    }
+    return 1;
+}
+
+// Function to map a compiled configuration and check its structure.
+// Lookups on it afterwards read the mapping in place and never allocate.
+int openCompiledConfig(const char *filename, CompiledConfig *config) {
+    if (!openSourceBuffer(filename, &config->source)) {
+        reportError("Failed to open file %s\n", filename);
+        return 0;
+    }
+    if (!loadCompiledConfig(config)) {
+        reportError("Invalid compiled configuration %s\n", filename);
+        closeSourceBuffer(&config->source);
+        return 0;
+    }
+    return 1;
+}
+
+// Function to release a compiled configuration
+void closeCompiledConfig(CompiledConfig *config) {
+    closeSourceBuffer(&config->source);
+    config->nodes = NULL;
+    config->strings = NULL;
+    config->nodeCount = 0;
+    config->stringsSize = 0;
+}
+
+// Function to get the key of a compiled node
+const char *compiledKey(const CompiledConfig *config, uint32_t index) {
+    return config->strings + config->nodes[index].key;
+}
+
+// Function to get the value of a compiled node (NULL for blocks)
+const char *compiledValue(const CompiledConfig *config, uint32_t index) {
+    const CompiledNode *node = &config->nodes[index];
+    return node->value == COMPILED_NO_VALUE ? NULL : config->strings + node->value;
+}
+
+// Function to find the first child of a compiled node with the given key; returns its index or -1
+long compiledFindChild(const CompiledConfig *config, uint32_t parent, const char *key, size_t keyLength) {
+    uint32_t end = config->nodes[parent].end;
+    for (uint32_t child = parent + 1; child < end; child = config->nodes[child].end) {
+        const CompiledNode *node = &config->nodes[child];
+        if (node->keyLength == keyLength && memcmp(config->strings + node->key, key, keyLength) == 0) {
+            return (long)child;
+        }
+    }
+    return -1;
+}
+
+// Function to look up a dotted path such as "born.birthPlace"; returns the node index or -1
+long compiledLookup(const CompiledConfig *config, const char *path) {
+    uint32_t index = 0;
+    while (*path) {
+        const char *dot = strchr(path, '.');
+        size_t length = dot ? (size_t)(dot - path) : strlen(path);
+        long child = compiledFindChild(config, index, path, length);
+        if (child < 0) return -1;
+        index = (uint32_t)child;
+        path += length;
+        if (*path == '.') path++;
+    }
+    return (long)index;
+}
+
+// Function to rebuild a ConfigItem tree over a compiled configuration. Keys
+// and values point into the mapping; only the nodes are allocated, from the arena.
+ConfigItem *compiledToConfigItems(const CompiledConfig *config, Arena *arena) {
+    typedef struct OpenBlock {
+        ConfigItem *item;
+        uint32_t end;
+    } OpenBlock;
+
+    ConfigItem *items = (ConfigItem *)arenaAlloc(arena, config->nodeCount * sizeof(ConfigItem), _Alignof(ConfigItem));
+    size_t stackCapacity = 64;
+    OpenBlock *stack = (OpenBlock *)malloc(stackCapacity * sizeof(OpenBlock));
+    if (!items || !stack) {
+        free(stack);
+        reportError("Memory allocation failed\n");
+        return NULL;
+    }
+
+    size_t depth = 0;
+    for (uint32_t i = 0; i < config->nodeCount; i++) {
+        ConfigItem *item = &items[i];
+        item->key = (char *)compiledKey(config, i);
+        item->keyInterned = 0;
+        item->value = (char *)compiledValue(config, i);
+        item->valueLength = 0;
+        item->valueType = VALUE_NULL;
+        item->valueFlags = 0;
+        if (item->value) {
+            item->valueLength = (uint32_t)strnlen(item->value, config->nodes[i].valueLength);
+            item->valueType = classifyValue(item->value, item->valueLength, &item->valueFlags);
+        }
+        item->next = NULL;
+        item->child = NULL;
+        item->lastChild = NULL;
+
+        while (depth > 0 && stack[depth - 1].end <= i) depth--;
+        if (depth > 0) addChild(stack[depth - 1].item, item);
+
+        if (config->nodes[i].end > i + 1) {
+            if (depth == stackCapacity) {
+                OpenBlock *grown = (OpenBlock *)realloc(stack, stackCapacity * 2 * sizeof(OpenBlock));
+                if (!grown) {
+                    free(stack);
+                    reportError("Memory allocation failed\n");
+                    return NULL;
+                }
+                stack = grown;
+                stackCapacity *= 2;
+            }
+            stack[depth].item = item;
+            stack[depth].end = config->nodes[i].end;
+            depth++;
+        }
+    }
+    free(stack);
+    return &items[0];
+}
+
+// Function to flatten a ConfigItem tree into the compiled layout, in memory:
+// nodes stored contiguously in document order, children as index ranges, and
+// keys and values as offsets into one string table. Each node also keeps its
+// value's type, so the emitters below do not classify values again. Release
+// the result with closeCompiledConfig.
+int flattenConfig(ConfigItem *root, CompiledConfig *config) {
+    OutputWriter out;
+    writerInitMemory(&out);
+    if (!compileNodesToWriter(root, &out, 1) || out.failed) {
+        writerClose(&out);
+        return 0;
+    }
+
+    CompiledHeader header;
+    memcpy(&header, out.buffer, sizeof(header));
+    config->source.data = out.buffer;
+    config->source.length = out.length;
+    config->source.mapped = 0;
+    config->nodes = (const CompiledNode *)(out.buffer + sizeof(header));
+    config->strings = out.buffer + sizeof(header) + (size_t)header.nodeCount * sizeof(CompiledNode);
+    config->nodeCount = header.nodeCount;
+    config->stringsSize = header.stringsSize;
+    return 1;
+}
+
+// Function to get a compiled node's key length as the emitters write it, up to its first NUL
+static size_t compiledKeyLength(const CompiledConfig *config, uint32_t index) {
+    const CompiledNode *node = &config->nodes[index];
+    if (node->flags & COMPILED_TYPED) return node->keyLength;
+    return strnlen(config->strings + node->key, node->keyLength);
+}
+
+// Function to get a compiled node's value as the emitters write it: up to
+// its first NUL, with its checkDesign type and escaping flags
+static const char *compiledScalar(const CompiledConfig *config, uint32_t index, size_t *length, uint8_t *type, uint8_t *flags) {
+    const CompiledNode *node = &config->nodes[index];
+    const char *value = config->strings + node->value;
+    if (node->flags & COMPILED_TYPED) {
+        *length = node->valueLength;
+        *type = (uint8_t)node->flags;
+        *flags = (uint8_t)(node->flags >> 8);
+    }
+    
+    else {
+        *length = strnlen(value, node->valueLength);
+        *type = classifyValue(value, *length, flags);
+    }
+    return value;
+}
+
+// Function to index the children of a compiled object by key
+static int buildCompiledKeyIndex(KeyIndex *index, const CompiledConfig *config, uint32_t parent) {
+    const CompiledNode *nodes = config->nodes;
+    int count = 0;
+    for (uint32_t child = parent + 1; child < nodes[parent].end; child = nodes[child].end) count++;
+    if (!allocKeyIndex(index, count)) return 0;
+
+    int i = 0;
+    for (uint32_t child = parent + 1; child < nodes[parent].end; child = nodes[child].end, i++) {
+        index->nodes[i] = child;
+        indexKey(index, i, config->strings + nodes[child].key, NULL);
+    }
+    return 1;
+}
+
+void serializeCompiledJSONToWriter(const CompiledConfig *config, uint32_t parent, OutputWriter *out, int indent, int style);
+
+// Function to write a compiled node's value (nested object, scalar, or null) as JSON
+static void writeCompiledJSONValue(const CompiledConfig *config, uint32_t index, OutputWriter *out, int indent, int style) {
+    const CompiledNode *node = &config->nodes[index];
+    if (node->end > index + 1) {
+        serializeCompiledJSONToWriter(config, index, out, indent + 1, style);
+    }
+    
+    else if (node->value != COMPILED_NO_VALUE) {
+        size_t length;
+        uint8_t type;
+        uint8_t flags;
+        const char *value = compiledScalar(config, index, &length, &type, &flags);
+        writeJSONScalar(value, length, type, flags, out, style);
+    }
+    
+    else {
+        writerWrite(out, "null", 4);
+    }
+}
+
+// JSON serialization of a compiled node's children, into a writer; the output
+// is the same as serializeJSONToWriter's for the tree it was compiled from
+void serializeCompiledJSONToWriter(const CompiledConfig *config, uint32_t parent, OutputWriter *out, int indent, int style) {
+    const CompiledNode *nodes = config->nodes;
+    if (nodes[parent].end == parent + 1) {
+        writerWrite(out, "{}", 2);
+        return;
+    }
+
+    KeyIndex index;
+    if (!buildCompiledKeyIndex(&index, config, parent)) {
+        out->failed = 1;
+        return;
+    }
+
+    writerPutChar(out, '{');
+    size_t memberIndent = (size_t)(indent + 1) * 4;
+
+    int position = 0;
+    while (position < index.childCount) {
+        uint32_t child = index.nodes[position];
+        const char *key = config->strings + nodes[child].key;
+        if (position > 0) writerPutChar(out, ',');
+
+        writeJSONBreak(out, memberIndent, style);
+        writerPutChar(out, '"');
+        writeJSONEscapedSized(out, key, compiledKeyLength(config, child));
+        writerPutChar(out, '"');
+        writeJSONColon(out, style);
+
+        // Repeated keys become one array, as in serializeJSONToWriter
+        if (index.groups[index.group[position]].count > 1 && index.rank[position] == 0) {
+            writerPutChar(out, '[');
+            for (int j = position; j >= 0; j = index.nextSame[j]) {
+                if (j != position) writerPutChar(out, ',');
+                writeJSONBreak(out, memberIndent + 4, style);
+                writeCompiledJSONValue(config, index.nodes[j], out, indent, style);
+            }
+            writeJSONBreak(out, memberIndent, style);
+            writerPutChar(out, ']');
+            position = resumeAfterGroup(&index, position, key, NULL);
+        }
+        
+        else {
+            writeCompiledJSONValue(config, child, out, indent, style);
+            position++;
+        }
+    }
+    free(index.block);
+
+    writeJSONBreak(out, (size_t)indent * 4, style);
+    writerPutChar(out, '}');
+}
+
+// Function to serialize a compiled node's children to YAML, into a writer
+void serializeCompiledYAMLToWriter(const CompiledConfig *config, uint32_t parent, OutputWriter *out, int indent) {
+    const CompiledNode *nodes = config->nodes;
+    for (uint32_t child = parent + 1; child < nodes[parent].end; child = nodes[child].end) {
+        writerPutSpaces(out, (size_t)indent * 2);
+        writerWrite(out, config->strings + nodes[child].key, compiledKeyLength(config, child));
+
+        if (nodes[child].value != COMPILED_NO_VALUE) {
+            size_t length;
+            uint8_t type;
+            uint8_t flags;
+            const char *value = compiledScalar(config, child, &length, &type, &flags);
+            writeYAMLScalar(value, length, flags, out);
+        }
+        
+        else {
+            writerWrite(out, ":\n", 2);
+            serializeCompiledYAMLToWriter(config, child, out, indent + 1);
+        }
+    }
+}
+
+// Function to print a compiled node's children, as interpretConfig does
+void interpretCompiledConfig(const CompiledConfig *config, uint32_t parent, int indent) {
+    const CompiledNode *nodes = config->nodes;
+    for (uint32_t child = parent + 1; child < nodes[parent].end; child = nodes[child].end) {
+        for (int i = 0; i < indent; ++i) printf("  ");
+        if (nodes[child].value != COMPILED_NO_VALUE) {
+            printf("%s = %s\n", config->strings + nodes[child].key, config->strings + nodes[child].value);
+        }
+        
+        else {
+            printf("%s:\n", config->strings + nodes[child].key);
+            interpretCompiledConfig(config, child, indent + 1);
+        }
+    }
+}
+
+#define PARALLEL_MIN_SLICE (1024 * 1024)
+
+// One slice of a parallel parse. The source is cut into slices at line
+// starts; each slice's chunk runs from its first top-level line to the next
+// slice's, so every chunk holds whole top-level entries.
+typedef struct ParseSlice {
+    const char *data;
+    const char *end;            // end of the whole source
+    const char *start;          // first line of the slice
+    const char *next;           // first line of the next slice (or end)
+    long delta;                 // net block depth change over the slice
+    long lowest;                // lowest depth reached, relative to the start
+    long depth;                 // depth at start, once the slices are combined
+    long nextDepth;
+    Arena arena;
+    Arena *useArena;            // &arena, or NULL when nodes are malloc'd
+    ConfigItem *root;           // holds the chunk's top-level entries
+} ParseSlice;
+
+// Function to follow block depth over a slice's lines
+static void *scanSlice(void *arg) {
+    ParseSlice *slice = (ParseSlice *)arg;
+    long depth = 0;
+    long lowest = 0;
+    const char *cursor = slice->start;
+    while (cursor < slice->next) {
+        const char *line = cursor;
+        const char *lineEnd = lineBounds(cursor, slice->next, &cursor);
+        const char *mark;
+        int kind = classifyLine(&line, lineEnd, &mark);
+        if (kind == LINE_BEGIN_BLOCK) depth++;
+        else if (kind == LINE_END_BLOCK && --depth < lowest) lowest = depth;
+    }
+    slice->delta = depth;
+    slice->lowest = lowest;
+    return NULL;
+}
+
+// Function to find the first line at or after `from` that starts at the top
+// level, given the block depth there; the end of the source if there is none
+static const char *findTopLevelLine(const char *from, const char *end, long depth) {
+    const char *cursor = from;
+    while (cursor < end && depth > 0) {
+        const char *line = cursor;
+        const char *lineEnd = lineBounds(cursor, end, &cursor);
+        const char *mark;
+        int kind = classifyLine(&line, lineEnd, &mark);
+        if (kind == LINE_BEGIN_BLOCK) depth++;
+        else if (kind == LINE_END_BLOCK) depth--;
+    }
+    return cursor;
+}
+
+// Function to parse a slice's chunk under a root of its own
+static void *parseSlice(void *arg) {
+    ParseSlice *slice = (ParseSlice *)arg;
+    // Errors are not reported from here: a failed parse is run again
+    // sequentially, which reports them the usual way
+    Report quiet;
+    writerInitMemory(&quiet.log);
+    Report *previous = reportRedirect(&quiet);
+
+    const char *first = slice->start == slice->data ? slice->data
+                                                    : findTopLevelLine(slice->start, slice->end, slice->depth);
+    const char *last = findTopLevelLine(slice->next, slice->end, slice->nextDepth);
+    slice->root = NULL;
+    if (first < last) {
+        slice->root = parseV2Buffer(first, (size_t)(last - first), slice->useArena);
+    }
+
+    else {
+        slice->root = createConfigItemSized(slice->useArena, "root", 4, NULL, 0);
+    }
+
+    reportRedirect(previous);
+    writerClose(&quiet.log);
+    return NULL;
+}
+
+// Function to run one step of a parallel parse on every slice, the first on this thread
+static int runSlices(ParseSlice *slices, size_t count, void *(*step)(void *)) {
+    pthread_t *threads = (pthread_t *)malloc(count * sizeof(pthread_t));
+    if (!threads) return 0;
+    size_t started = 1;
+    while (started < count && pthread_create(&threads[started], NULL, step, &slices[started]) == 0) {
+        started++;
+    }
+    // Slices whose thread could not start run here
+    for (size_t i = started; i < count; i++) step(&slices[i]);
+    step(&slices[0]);
+    for (size_t i = 1; i < started; i++) pthread_join(threads[i], NULL);
+    free(threads);
+    return 1;
+}
+
+// Function to parse .v2 source held in memory on up to `threads` threads. The
+// source is split between top-level entries, the chunks are parsed at the same
+// time, and their entries are joined under one root in document order, so the
+// tree is the one parseV2Buffer builds. Small inputs are parsed on this thread.
+ConfigItem *parseV2BufferParallel(const char *data, size_t length, Arena *arena, int threads) {
+    size_t count = threads > 1 ? length / PARALLEL_MIN_SLICE : 0;
+    if (count > (size_t)threads) count = (size_t)threads;
+    if (count < 2) return parseV2Buffer(data, length, arena);
+
+    ParseSlice *slices = (ParseSlice *)calloc(count, sizeof(ParseSlice));
+    if (!slices) return parseV2Buffer(data, length, arena);
+
+    // Cut at the line start after each even share of the bytes
+    const char *end = data + length;
+    for (size_t i = 0; i < count; i++) {
+        ParseSlice *slice = &slices[i];
+        slice->data = data;
+        slice->end = end;
+        if (i == 0) {
+            slice->start = data;
+        }
+
+        else {
+            const char *cut = data + length / count * i;
+            if (cut < slices[i - 1].start) cut = slices[i - 1].start;
+            const char *newline = (const char *)memchr(cut, '\n', (size_t)(end - cut));
+            slice->start = newline ? newline + 1 : end;
+            slices[i - 1].next = slice->start;
+        }
+        slice->next = end;
+        arenaInit(&slice->arena);
+        slice->useArena = arena ? &slice->arena : NULL;
+    }
+
+    // Depth at each cut; a closing brace with no block open is an error, left
+    // for the sequential parse to report
+    int ok = runSlices(slices, count, scanSlice);
+    long depth = 0;
+    for (size_t i = 0; ok && i < count; i++) {
+        slices[i].depth = depth;
+        if (depth + slices[i].lowest < 0) ok = 0;
+        depth += slices[i].delta;
+        if (i > 0) slices[i - 1].nextDepth = slices[i].depth;
+    }
+    slices[count - 1].nextDepth = 0;
+
+    if (ok) ok = runSlices(slices, count, parseSlice);
+    ConfigItem *root = NULL;
+    for (size_t i = 0; ok && i < count; i++) {
+        if (!slices[i].root) ok = 0;
+    }
+    if (ok) {
+        root = createConfigItemSized(arena, "root", 4, NULL, 0);
+        ok = root != NULL;
+    }
+
+    // Chain each chunk's entries after the previous one's
+    for (size_t i = 0; i < count; i++) {
+        ConfigItem *chunk = slices[i].root;
+        if (ok && chunk->child) {
+            if (root->child) root->lastChild->next = chunk->child;
+            else root->child = chunk->child;
+            root->lastChild = chunk->lastChild;
+        }
+        if (chunk) {
+            if (ok) chunk->child = NULL;
+            discardConfigItem(slices[i].useArena, chunk);
+        }
+        if (ok && arena) arenaAdopt(arena, &slices[i].arena);
+        else arenaRelease(&slices[i].arena);
+    }
+    free(slices);
+
+    if (!ok) {
+        if (root) discardConfigItem(arena, root);
+        return parseV2Buffer(data, length, arena);
+    }
+    return root;
+}
+
+// Parsers selectable from the command line
+enum {
+    PARSER_MMAP,
+    PARSER_STDIO,
+    PARSER_STREAM,
+    PARSER_PARALLEL
+};
+
+// Index from full dotted paths ("born.birthPlace") to nodes, built once after
+// parsing. Paths are placed with a minimal perfect hash (hash and displace):
+// the path's hash picks a bucket and the bucket's seed picks the slot, so a
+// lookup hashes the path once and checks exactly one entry. Where a path
+// occurs more than once, the first occurrence in the document is indexed.
+// Distinct paths whose hashes collide cannot share a slot: the first one is
+// placed, and the rest follow the placed entries and are searched in turn.
+#define PATH_NO_PARENT UINT32_MAX
+#define PATH_DIRECT_SLOT 0x80000000u    // seed flag: the low bits are the slot itself
+#define PATH_BUCKET_KEYS 2              // average paths per bucket
+
+typedef struct PathEntry {
+    uint64_t hash;
+    ConfigItem *item;
+    const char *key;       // item->key, kept here to save a load per lookup
+    uint32_t parent;       // entry of the enclosing path, or PATH_NO_PARENT
+    uint32_t keyLength;
+} PathEntry;
+
+typedef struct PathIndex {
+    PathEntry *entries;    // count placed entries, then overflowCount colliding ones
+    uint32_t *seeds;
+    uint32_t count;
+    uint32_t bucketCount;
+    uint32_t overflowCount;
+} PathIndex;
+
+static uint32_t pathBucket(uint64_t hash, uint32_t bucketCount) {
+    return (uint32_t)((hash >> 32) % bucketCount);
+}
+
+// Function to mix a path hash with a bucket seed into a slot
+static uint32_t pathSlot(uint64_t hash, uint32_t seed, uint32_t count) {
+    if (seed & PATH_DIRECT_SLOT) return seed & ~PATH_DIRECT_SLOT;
+    uint64_t x = hash ^ ((uint64_t)(seed + 1) * 0x9E3779B97F4A7C15ULL);
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return (uint32_t)(x % count);
+}
+
+// Function to spell out the path of an entry whose parents are entry indices
+static size_t pathString(const PathEntry *entries, uint32_t entry, char *out, size_t length) {
+    if (!out) {
+        length = 0;
+        for (uint32_t e = entry; e != PATH_NO_PARENT; e = entries[e].parent) {
+            length += entries[e].keyLength + (entries[e].parent != PATH_NO_PARENT);
+        }
+        return length;
+    }
+
+    for (uint32_t e = entry; e != PATH_NO_PARENT; e = entries[e].parent) {
+        length -= entries[e].keyLength;
+        memcpy(out + length, entries[e].key, entries[e].keyLength);
+        if (entries[e].parent != PATH_NO_PARENT) out[--length] = '.';
+    }
+    return 0;
+}
+
+// Function to tell whether two entries spell the same path
+static int samePath(const PathEntry *entries, uint32_t first, uint32_t second) {
+    size_t length = pathString(entries, first, NULL, 0);
+    if (length != pathString(entries, second, NULL, 0)) return 0;
+
+    char *a = (char *)malloc(length + 1);
+    char *b = (char *)malloc(length + 1);
+    int same = 0;
+    if (a && b) {
+        pathString(entries, first, a, length);
+        pathString(entries, second, b, length);
+        same = memcmp(a, b, length) == 0;
+    }
+    free(a);
+    free(b);
+    return same;
+}
+
+typedef struct PathOrder {
+    uint64_t hash;
+    uint32_t entry;
+} PathOrder;
+
+static int comparePathOrder(const void *a, const void *b) {
+    const PathOrder *x = (const PathOrder *)a;
+    const PathOrder *y = (const PathOrder *)b;
+    if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    return x->entry < y->entry ? -1 : x->entry > y->entry;
+}
+
+// Function to free a PathIndex
+void freePathIndex(PathIndex *index) {
+    if (index) {
+        free(index->entries);
+        free(index->seeds);
+        free(index);
+    }
+}
+
+// Function to collect every path below root, in document order
+static PathEntry *collectPaths(ConfigItem *root, uint32_t *count) {
+    typedef struct OpenBlock {
+        ConfigItem *item;
+        uint32_t entry;
+    } OpenBlock;
+
+    size_t capacity = 256;
+    size_t stackCapacity = 64;
+    size_t used = 0;
+    size_t depth = 0;
+    PathEntry *entries = (PathEntry *)malloc(capacity * sizeof(PathEntry));
+    OpenBlock *stack = (OpenBlock *)malloc(stackCapacity * sizeof(OpenBlock));
+    int ok = entries && stack;
+
+    for (ConfigItem *item = root->child; ok && item; ) {
+        if (used == capacity) {
+            PathEntry *grown = used < PATH_DIRECT_SLOT / 2 ? (PathEntry *)realloc(entries, capacity * 2 * sizeof(PathEntry)) : NULL;
+            if (!grown) {
+                ok = 0;
+                break;
+            }
+            entries = grown;
+            capacity *= 2;
+        }
+
+        PathEntry *entry = &entries[used];
+        size_t keyLength = itemKeyLength(item);
+        entry->item = item;
+        entry->key = item->key;
+        entry->keyLength = (uint32_t)keyLength;
+        if (depth > 0) {
+            entry->parent = stack[depth - 1].entry;
+            entry->hash = hashBytes(hashBytes(entries[entry->parent].hash, ".", 1), item->key, keyLength);
+        }
+
+        else {
+            entry->parent = PATH_NO_PARENT;
+            entry->hash = hashBytes(1469598103934665603ULL, item->key, keyLength);
+        }
+        used++;
+
+        if (item->child) {
+            if (depth == stackCapacity) {
+                OpenBlock *grown = (OpenBlock *)realloc(stack, stackCapacity * 2 * sizeof(OpenBlock));
+                if (!grown) {
+                    ok = 0;
+                    break;
+                }
+                stack = grown;
+                stackCapacity *= 2;
+            }
+            stack[depth].item = item;
+            stack[depth].entry = (uint32_t)(used - 1);
+            depth++;
+            item = item->child;
+            continue;
+        }
+
+        while (!item->next && depth > 0) {
+            item = stack[--depth].item;
+        }
+        item = item->next;
+    }
+    free(stack);
+
+    if (!ok) {
+        free(entries);
+        reportError("Memory allocation failed\n");
+        return NULL;
+    }
+    *count = (uint32_t)used;
+    return entries;
+}
+
+// Function to place the distinct paths (listed in unique[]) in the index so
+// that every bucket's seed sends its paths to free slots
+static int placePaths(PathIndex *index, const PathEntry *paths, const uint32_t *unique, uint32_t *slotOf) {
+    uint32_t count = index->count;
+    uint32_t bucketCount = index->bucketCount;
+    uint32_t *bucketStart = (uint32_t *)calloc((size_t)bucketCount + 1, sizeof(uint32_t));
+    uint32_t *bucketOrder = (uint32_t *)malloc((size_t)bucketCount * sizeof(uint32_t));
+    uint32_t *bucketed = (uint32_t *)malloc(((size_t)count + 1) * sizeof(uint32_t));
+    uint32_t *slots = (uint32_t *)malloc(((size_t)count + 1) * sizeof(uint32_t));
+    unsigned char *taken = (unsigned char *)calloc((size_t)count + 1, 1);
+    uint32_t *sizeStart = NULL;
+    int ok = bucketStart && bucketOrder && bucketed && slots && taken;
+    if (!ok) reportError("Memory allocation failed\n");
+
+    // Group the paths by bucket
+    uint32_t largest = 0;
+    if (ok) {
+        for (uint32_t u = 0; u < count; u++) {
+            bucketStart[pathBucket(paths[unique[u]].hash, bucketCount) + 1]++;
+        }
+        for (uint32_t b = 0; b < bucketCount; b++) {
+            if (bucketStart[b + 1] > largest) largest = bucketStart[b + 1];
+            bucketStart[b + 1] += bucketStart[b];
+        }
+        memcpy(bucketOrder, bucketStart, (size_t)bucketCount * sizeof(uint32_t));
+        for (uint32_t u = 0; u < count; u++) {
+            uint32_t b = pathBucket(paths[unique[u]].hash, bucketCount);
+            bucketed[bucketOrder[b]++] = u;
+        }
+        sizeStart = (uint32_t *)calloc((size_t)largest + 2, sizeof(uint32_t));
+        ok = sizeStart != NULL;
+        if (!ok) reportError("Memory allocation failed\n");
+    }
+
+    // Largest buckets first, while most slots are still free
+    if (ok) {
+        for (uint32_t b = 0; b < bucketCount; b++) {
+            sizeStart[largest - (bucketStart[b + 1] - bucketStart[b]) + 1]++;
+        }
+        for (uint32_t size = 0; size <= largest; size++) sizeStart[size + 1] += sizeStart[size];
+        for (uint32_t b = 0; b < bucketCount; b++) {
+            bucketOrder[sizeStart[largest - (bucketStart[b + 1] - bucketStart[b])]++] = b;
+        }
+    }
+
+    // Find each bucket a seed; single paths just take the next free slot
+    uint32_t nextFree = 0;
+    for (uint32_t o = 0; ok && o < bucketCount; o++) {
+        uint32_t b = bucketOrder[o];
+        uint32_t first = bucketStart[b];
+        uint32_t size = bucketStart[b + 1] - first;
+        if (size == 0) break;
+
+        if (size == 1) {
+            while (taken[nextFree]) nextFree++;
+            index->seeds[b] = PATH_DIRECT_SLOT | nextFree;
+            slots[0] = nextFree;
+        }
+
+        else {
+            uint32_t seed = 0;
+            for (; seed < PATH_DIRECT_SLOT; seed++) {
+                uint32_t placed = 0;
+                for (; placed < size; placed++) {
+                    uint32_t slot = pathSlot(paths[unique[bucketed[first + placed]]].hash, seed, count);
+                    if (taken[slot]) break;
+                    taken[slot] = 1;
+                    slots[placed] = slot;
+                }
+                if (placed == size) break;
+                while (placed > 0) taken[slots[--placed]] = 0;
+            }
+            if (seed == PATH_DIRECT_SLOT) {
+                reportError("Failed to build the path index\n");
+                ok = 0;
+                break;
+            }
+            index->seeds[b] = seed;
+        }
+
+        for (uint32_t k = 0; k < size; k++) {
+            uint32_t path = unique[bucketed[first + k]];
+            taken[slots[k]] = 1;
+            index->entries[slots[k]] = paths[path];
+            slotOf[path] = slots[k];
+        }
+    }
+
+    free(bucketStart);
+    free(bucketOrder);
+    free(bucketed);
+    free(slots);
+    free(taken);
+    free(sizeStart);
+    return ok;
+}
+
+// Function to build the path index of a parsed tree
+PathIndex *buildPathIndex(ConfigItem *root) {
+    uint32_t total = 0;
+    PathEntry *paths = collectPaths(root, &total);
+    if (!paths) return NULL;
+
+    PathIndex *index = (PathIndex *)calloc(1, sizeof(PathIndex));
+    PathOrder *order = (PathOrder *)malloc(((size_t)total + 1) * sizeof(PathOrder));
+    uint32_t *canonical = (uint32_t *)malloc(((size_t)total + 1) * sizeof(uint32_t));
+    uint32_t *unique = (uint32_t *)malloc(((size_t)total + 1) * sizeof(uint32_t));
+    uint32_t *slotOf = (uint32_t *)malloc(((size_t)total + 1) * sizeof(uint32_t));
+    unsigned char *colliding = (unsigned char *)calloc((size_t)total + 1, 1);
+    int ok = index && order && canonical && unique && slotOf && colliding;
+    if (!ok) reportError("Memory allocation failed\n");
+
+    // Repeated paths share a hash; keep the first and point the rest at it.
+    // A path that only shares the hash starts a path of its own, which the
+    // minimal perfect hash cannot place, so it is marked as colliding.
+    if (ok) {
+        for (uint32_t i = 0; i < total; i++) {
+            order[i].hash = paths[i].hash;
+            order[i].entry = i;
+        }
+        qsort(order, total, sizeof(PathOrder), comparePathOrder);
+        for (uint32_t i = 0; i < total; i++) {
+            // The distinct paths seen so far with this hash, kept in unique[] until it is filled below
+            uint32_t distinct = 1;
+            unique[0] = order[i].entry;
+            canonical[order[i].entry] = order[i].entry;
+            while (i + 1 < total && order[i + 1].hash == order[i].hash) {
+                uint32_t repeat = order[++i].entry;
+                canonical[repeat] = repeat;
+                for (uint32_t k = 0; k < distinct; k++) {
+                    if (samePath(paths, unique[k], repeat)) {
+                        canonical[repeat] = unique[k];
+                        break;
+                    }
+                }
+                if (canonical[repeat] == repeat) {
+                    colliding[repeat] = 1;
+                    unique[distinct++] = repeat;
+                }
+            }
+        }
+    }
+
+    if (ok) {
+        uint32_t count = 0;
+        uint32_t overflow = 0;
+        for (uint32_t i = 0; i < total; i++) {
+            if (canonical[i] != i) continue;
+            if (colliding[i]) overflow++;
+            else unique[count++] = i;
+        }
+        index->count = count;
+        index->overflowCount = overflow;
+        index->bucketCount = count / PATH_BUCKET_KEYS + 1;
+        index->entries = (PathEntry *)malloc(((size_t)count + overflow + 1) * sizeof(PathEntry));
+        index->seeds = (uint32_t *)calloc(index->bucketCount, sizeof(uint32_t));
+        ok = index->entries && index->seeds;
+        if (!ok) reportError("Memory allocation failed\n");
+    }
+
+    // Colliding paths go after the placed ones, in document order
+    if (ok && placePaths(index, paths, unique, slotOf)) {
+        uint32_t slot = index->count;
+        for (uint32_t i = 0; i < total; i++) {
+            if (canonical[i] != i || !colliding[i]) continue;
+            index->entries[slot] = paths[i];
+            slotOf[i] = slot++;
+        }
+
+        // Parents were numbered in document order; renumber them by slot
+        for (uint32_t s = 0; s < index->count + index->overflowCount; s++) {
+            PathEntry *entry = &index->entries[s];
+            if (entry->parent != PATH_NO_PARENT) entry->parent = slotOf[canonical[entry->parent]];
+        }
+    }
+
+    else {
+        ok = 0;
+    }
+
+    free(order);
+    free(canonical);
+    free(unique);
+    free(slotOf);
+    free(colliding);
+    free(paths);
+    if (!ok) {
+        freePathIndex(index);
+        return NULL;
+    }
+    return index;
+}
+
+// Function to tell whether an entry spells out path, checking one key at a
+// time from the end
+static int pathEntryMatches(const PathIndex *index, const PathEntry *entry, const char *path, size_t length) {
+    size_t end = length;
+    for (;;) {
+        if (entry->keyLength > end || memcmp(path + end - entry->keyLength, entry->key, entry->keyLength) != 0) return 0;
+        end -= entry->keyLength;
+        if (entry->parent == PATH_NO_PARENT) return end == 0;
+        if (end == 0 || path[end - 1] != '.') return 0;
+        end--;
+        entry = &index->entries[entry->parent];
+    }
+}
+
+// Function to find the node at a dotted path; NULL if there is none
+ConfigItem *pathIndexFind(const PathIndex *index, const char *path) {
+    if (!index || index->count == 0) return NULL;
+
+    size_t length = strlen(path);
+    uint64_t hash = hashBytes(1469598103934665603ULL, path, length);
+    uint32_t seed = index->seeds[pathBucket(hash, index->bucketCount)];
+    const PathEntry *entry = &index->entries[pathSlot(hash, seed, index->count)];
+    if (entry->hash != hash) return NULL;
+    if (pathEntryMatches(index, entry, path, length)) return entry->item;
+
+    // The slot holds another path with the same hash; try the colliding ones
+    for (uint32_t i = 0; i < index->overflowCount; i++) {
+        entry = &index->entries[index->count + i];
+        if (entry->hash == hash && pathEntryMatches(index, entry, path, length)) return entry->item;
+    }
+    return NULL;
+}
+
+// A parsed .v2 file whose nodes and strings all live in one arena. A
+// compiled (.v2c) file keeps its mapping open instead and is emitted from
+// its node table; a tree, whose strings point into the mapping, is only
+// built by documentTree for the consumers that need one. With PARSER_STREAM
+// there is no tree: the file is read again, in chunks, for each output and
+// emitted from parser events.
+typedef struct ConfigDocument {
+    ConfigItem *root;
+    Arena arena;
+    CompiledConfig compiled;
+    PathIndex *index;      // built by v2_open for path lookups
+    char *streamFilename;  // PARSER_STREAM only
+    uint32_t *duplicates;  // blocks that repeat a key, from scanDuplicateKeys
+    size_t duplicateCount;
+    size_t sourceLength;   // bytes in the file it was loaded from
+} ConfigDocument;
+
+// Function to free a ConfigDocument and its whole tree in one release
+void freeConfigDocument(ConfigDocument *document) {
+    if (document) {
+        arenaRelease(&document->arena);
+        if (document->compiled.source.data) closeCompiledConfig(&document->compiled);
+        freePathIndex(document->index);
+        free(document->streamFilename);
+        free(document->duplicates);
+        free(document);
+    }
+}
+
+// Function to tell whether a file starts with the compiled-format magic
+static int fileIsCompiled(const char *filename) {
+    char magic[sizeof(compiledMagic)];
+    FILE *file = fopen(filename, "rb");
+    if (!file) return 0;
+    size_t bytesRead = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+    return isCompiledConfig(magic, bytesRead);
+}
+
+int onlineCPUs(void);
+
+// Function to load a .v2 or .v2c file ("-" for stdin) into a ConfigDocument with
+// the selected parser; with PARSER_STREAM a .v2 file is only checked, and for a
+// .v2c file only the node table is loaded, so in both cases root stays NULL
+ConfigDocument *loadV2Document(const char *filename, int parser) {
+    ConfigDocument *document = (ConfigDocument *)calloc(1, sizeof(ConfigDocument));
+    if (!document) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return NULL;
+    }
+    arenaInit(&document->arena);
+
+    // Stdin can be read only once, so it is always read whole into a buffer
+    if (isStandardStream(filename) && parser != PARSER_PARALLEL) parser = PARSER_MMAP;
+
+#ifndef _WIN32
+    struct stat info;
+    if ((parser == PARSER_STDIO || parser == PARSER_STREAM) && stat(filename, &info) == 0) document->sourceLength = (size_t)info.st_size;
+#endif
+
+    if (parser == PARSER_STDIO && !fileIsCompiled(filename)) {
+        document->root = parseV2ConfigInto(filename, &document->arena);
+    }
+    
+    else if (parser == PARSER_STREAM && !fileIsCompiled(filename)) {
+        // Check the syntax now, so a bad file fails before any output is opened
+        document->streamFilename = strdup(filename);
+        if (!document->streamFilename ||
+            !scanDuplicateKeys(filename, &document->duplicates, &document->duplicateCount)) {
+            freeConfigDocument(document);
+            return NULL;
+        }
+        return document;
+    }
+    
+    else {
+        SourceBuffer source;
+        if (!openSourceBuffer(filename, &source)) {
+            reportError("Failed to open file %s\n", filename);
+        }
+
+        else if (isCompiledConfig(source.data, source.length)) {
+            document->sourceLength = source.length;
+            document->compiled.source = source;
+            if (!loadCompiledConfig(&document->compiled)) {
+                reportError("Invalid compiled configuration %s\n", filename);
+                closeCompiledConfig(&document->compiled);
+            }
+        }
+
+        else {
+            document->sourceLength = source.length;
+            if (parser == PARSER_PARALLEL) {
+                document->root = parseV2BufferParallel(source.data, source.length, &document->arena, onlineCPUs());
+            }
+
+            else {
+                document->root = parseV2Buffer(source.data, source.length, &document->arena);
+            }
+            closeSourceBuffer(&source);
+        }
+    }
+
+    if (!document->root && !document->compiled.nodes) {
+        freeConfigDocument(document);
+        return NULL;
+    }
+    return document;
+}
+
+// Function to get the tree of a loaded document, building it over a compiled
+// document's mapping the first time; NULL for a streamed document
+ConfigItem *documentTree(ConfigDocument *document) {
+    if (!document->root && document->compiled.nodes) {
+        document->root = compiledToConfigItems(&document->compiled, &document->arena);
+    }
+    return document->root;
+}
+
+// Function to open a .v2 or .v2c file for lookups by path
+ConfigDocument *v2_open(const char *filename) {
+    ConfigDocument *document = loadV2Document(filename, PARSER_MMAP);
+    if (document) {
+        ConfigItem *root = documentTree(document);
+        document->index = root ? buildPathIndex(root) : NULL;
+        if (!document->index) {
+            freeConfigDocument(document);
+            return NULL;
+        }
+    }
+    return document;
+}
+
+// Function to get the value at a dotted path such as "born.birthPlace".
+// The value is returned as written, quotes included; blocks and missing
+// paths give NULL.
+const char *v2_get(ConfigDocument *document, const char *path) {
+    ConfigItem *item = pathIndexFind(document->index, path);
+    return item ? item->value : NULL;
+}
+
+// Function to close a document opened with v2_open
+void v2_close(ConfigDocument *document) {
+    freeConfigDocument(document);
+}
+
+// Options that apply to the files named after them on the command line
+typedef struct TranspileOptions {
+    int transpileJSON;
+    int transpileYAML;
+    int transpileMsgPack;
+    int transpileCBOR;
+    int compactJSON;       // --compact: JSON without whitespace
+    int checkDesign;
+    int checkYAML;
+    int parser;
+    int validateOnly;
+    int compile;
+    int toStdout;          // --stdout, -o - or stdin input: outputs go to stdout
+    int stats;             // --stats: measure each phase
+} TranspileOptions;
+
+// What --stats measured for one file, or summed over a run
+typedef struct TranspileStats {
+    double parseSeconds;
+    double compileSeconds;
+    double jsonSeconds;    // without the time spent validating it
+    double yamlSeconds;
+    double msgpackSeconds;
+    double cborSeconds;
+    double validateSeconds;
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+    size_t nodes;
+    size_t treeBytes;      // arena memory holding the tree (the peak, as it never shrinks)
+    size_t allocations;    // arena blocks behind it
+    size_t files;
+    size_t failed;         // of those files, the ones that failed to parse or to write
+} TranspileStats;
+
+// Function to read the monotonic clock in seconds; only called when measuring
+static double statsClock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+// Function to build the name of an output file next to its input
+static char *outputFilename(const char *input, const char *newExt) {
+    char *output = (char *)malloc(strlen(input) + strlen(newExt) + 1);
+    if (!output) {
+        reportError("Memory allocation failed\n");
+        return NULL;
+    }
+    changeFileExtension(input, output, newExt);
+    return output;
+}
+
+// Function to name an output: "stdout" when it goes there, else the file next to the input
+static char *outputName(const char *input, const char *newExt, const TranspileOptions *options) {
+    return options->toStdout ? strdup("stdout") : outputFilename(input, newExt);
+}
+
+// Sink that writes to stdout, or into the report (context) of the job being
+// run so parallel jobs still print their outputs whole and in input order
+static int writerSinkStdout(void *context, const char *data, size_t length) {
+    Report *report = (Report *)context;
+    if (report) {
+        reportRecord(report, 'O', data, length);
+        return !report->log.failed;
+    }
+    return fwrite(data, 1, length, stdout) == length;
+}
+
+// The formats transpileDocument writes, in the order it writes them
+enum {
+    OUTPUT_JSON,
+    OUTPUT_YAML,
+    OUTPUT_MSGPACK,
+    OUTPUT_CBOR,
+    OUTPUT_FORMATS
+};
+
+static const char *const outputFormatNames[OUTPUT_FORMATS] = { "JSON", "YAML", "MessagePack", "CBOR" };
+static const char *const outputExtensions[OUTPUT_FORMATS] = { ".json", ".yaml", ".msgpack", ".cbor" };
+
+// Hashes of the outputs last written for a watched file
+typedef struct OutputHashes {
+    uint64_t hash[OUTPUT_FORMATS];
+    int known[OUTPUT_FORMATS];
+} OutputHashes;
+
+// Function to write a rendered output unless it matches the last one written
+// (or, the first time, the file already on disk). Returns 1 if the file was
+// written, 0 if it was left alone and -1 if writing failed.
+static int writeIfChanged(const char *filename, const OutputWriter *rendered, uint64_t *hash, int *known) {
+    uint64_t renderedHash = hashContent(rendered->buffer, rendered->length, 0);
+    if (!*known) {
+        SourceBuffer existing;
+        if (openSourceBuffer(filename, &existing)) {
+            *hash = hashContent(existing.data, existing.length, 0);
+            *known = 1;
+            closeSourceBuffer(&existing);
+        }
+    }
+    if (*known && *hash == renderedHash) return 0;
+
+    FILE *file = fopen(filename, "wb");
+    if (!file) return -1;
+    int written = fwrite(rendered->buffer, 1, rendered->length, file) == rendered->length;
+    if (fclose(file) != 0) written = 0;
+
+    *hash = renderedHash;
+    *known = written;
+    return written ? 1 : -1;
+}
+
+// Function to count the nodes of a tree, the root included
+static size_t countNodes(const ConfigItem *item) {
+    size_t count = 0;
+    for (; item; item = item->next) {
+        count += 1 + countNodes(item->child);
+    }
+    return count;
+}
+
+// Function to write a byte count with a readable unit
+static void formatBytes(uint64_t bytes, char *text, size_t size) {
+    if (bytes < 1024) {
+        snprintf(text, size, "%llu B", (unsigned long long)bytes);
+    }
+
+    else if (bytes < 1024 * 1024) {
+        snprintf(text, size, "%.1f KB", (double)bytes / 1024.0);
+    }
+
+    else {
+        snprintf(text, size, "%.1f MB", (double)bytes / (1024.0 * 1024.0));
+    }
+}
+
+// Function to print --stats for one file, or for a whole run
+void printStats(void (*status)(const char *format, ...), const char *label, const TranspileStats *stats) {
+    char read[32];
+    char written[32];
+    char tree[32];
+    char failed[32] = "";
+    formatBytes(stats->bytesRead, read, sizeof(read));
+    formatBytes(stats->bytesWritten, written, sizeof(written));
+    formatBytes(stats->treeBytes, tree, sizeof(tree));
+    if (stats->failed > 0 && stats->files == 1) snprintf(failed, sizeof(failed), " (failed)");
+
+    else if (stats->failed > 0) snprintf(failed, sizeof(failed), " (%zu failed)", stats->failed);
+    status("Stats for %s%s: parse %.2f ms, compile %.2f ms, JSON %.2f ms, YAML %.2f ms, MessagePack %.2f ms, "
+           "CBOR %.2f ms, validate %.2f ms; read %s, wrote %s; %zu node%s, tree %s in %zu allocation%s\n",
+           label, failed, stats->parseSeconds * 1e3, stats->compileSeconds * 1e3, stats->jsonSeconds * 1e3,
+           stats->yamlSeconds * 1e3, stats->msgpackSeconds * 1e3, stats->cborSeconds * 1e3,
+           stats->validateSeconds * 1e3, read, written,
+           stats->nodes, stats->nodes == 1 ? "" : "s", tree,
+           stats->allocations, stats->allocations == 1 ? "" : "s");
+}
+
+// Function to write --stats as one JSON object (filename NULL for a run's total)
+void writeStatsJSON(OutputWriter *out, const char *filename, const TranspileStats *stats) {
+    char numbers[512];
+    writerPutString(out, "{ ");
+    if (filename) {
+        writerPutString(out, "\"file\": ");
+        writeJSONQuoted(out, filename);
+        writerPutString(out, ", ");
+    }
+
+    else {
+        snprintf(numbers, sizeof(numbers), "\"files\": %zu, ", stats->files);
+        writerPutString(out, numbers);
+    }
+    snprintf(numbers, sizeof(numbers),
+             "\"failed\": %zu, \"parseMs\": %.3f, \"compileMs\": %.3f, \"jsonMs\": %.3f, \"yamlMs\": %.3f, \"msgpackMs\": %.3f, "
+             "\"cborMs\": %.3f, \"validateMs\": %.3f, \"bytesRead\": %llu, \"bytesWritten\": %llu, \"nodes\": %zu, "
+             "\"treeBytes\": %zu, \"allocations\": %zu }",
+             stats->failed, stats->parseSeconds * 1e3, stats->compileSeconds * 1e3, stats->jsonSeconds * 1e3,
+             stats->yamlSeconds * 1e3, stats->msgpackSeconds * 1e3, stats->cborSeconds * 1e3,
+             stats->validateSeconds * 1e3, (unsigned long long)stats->bytesRead,
+             (unsigned long long)stats->bytesWritten, stats->nodes, stats->treeBytes, stats->allocations);
+    writerPutString(out, numbers);
+}
+
+// One output of transpileDocument while it is written: where it goes, the
+// validator fed as it is written, and the diagnostics held back until its
+// status line is out
+typedef struct PendingOutput {
+    int format;                // OUTPUT_*
+    char *filename;
+    FILE *file;
+    int opened;
+    int check;                 // validate the output as it is written
+    int timed;                 // --stats: time the validator separately
+    JSONValidator jsonValidator;
+    YAMLValidator yamlValidator;
+    Report diagnostics;
+    OutputWriter out;
+    OutputWriter rendered;     // with hashes: the whole output, compared before writing
+    AsyncFile async;
+    int closed;
+    int written;
+    double started;
+    double validateSeconds;
+} PendingOutput;
+
+// Tap that feeds an output's validator; what it reports goes to the output's own diagnostics
+static void pendingOutputTap(void *context, const char *data, size_t length) {
+    PendingOutput *pending = (PendingOutput *)context;
+    Report *previous = reportRedirect(&pending->diagnostics);
+    double start = pending->timed ? statsClock() : 0;
+    if (pending->format == OUTPUT_JSON) {
+        jsonValidatorTap(&pending->jsonValidator, data, length);
+    }
+
+    else {
+        yamlValidatorTap(&pending->yamlValidator, data, length);
+    }
+    if (pending->timed) pending->validateSeconds += statsClock() - start;
+    reportRedirect(previous);
+}
+
+// Function to open one output of a document: to memory with hashes, to
+// stdout, through a background writer when one is given, or to its file.
+// Returns 0 if there is nothing to write to; finishOutput reports why.
+static int beginOutput(PendingOutput *pending, int format, const char *filename, const TranspileOptions *options,
+                       int hashing, int timed, AsyncWriter *async, Report *job) {
+    memset(pending, 0, sizeof(*pending));
+    pending->format = format;
+    pending->filename = outputName(filename, outputExtensions[format], options);
+    if (!pending->filename) return 0;
+    const char *mode = format == OUTPUT_MSGPACK || format == OUTPUT_CBOR ? "wb" : "w";
+    pending->file = hashing || options->toStdout ? NULL : fopen(pending->filename, mode);
+    pending->opened = pending->file || hashing || options->toStdout;
+    if (!pending->opened) return 0;
+
+    jsonValidatorInit(&pending->jsonValidator);
+    yamlValidatorInit(&pending->yamlValidator);
+    writerInitMemory(&pending->diagnostics.log);
+    if (hashing) {
+        writerInitMemory(&pending->rendered);
+        writerInitSink(&pending->out, writerSinkMemory, &pending->rendered);
+    }
+
+    else if (options->toStdout) {
+        writerInitSink(&pending->out, writerSinkStdout, job);
+    }
+
+    else if (async) {
+        pending->async.writer = async;
+        pending->async.file = pending->file;
+        writerInitSink(&pending->out, writerSinkAsync, &pending->async);
+    }
+
+    else {
+        writerInitFile(&pending->out, pending->file);
+    }
+
+    // The binary formats have no validator
+    if (format == OUTPUT_JSON) pending->check = options->checkDesign;
+    else if (format == OUTPUT_YAML) pending->check = options->checkYAML;
+    pending->timed = timed;
+    if (pending->check) writerSetTap(&pending->out, pendingOutputTap, pending);
+    pending->started = timed ? statsClock() : 0;
+    return 1;
+}
+
+// Function to flush an output's writer; with a background writer, the
+// file has its last bytes only once that writer has stopped
+static void closeOutputWriter(PendingOutput *pending) {
+    if (pending->closed) return;
+    pending->written = writerClose(&pending->out);
+    pending->closed = 1;
+}
+
+// Function to finish one output: close it, write it if it changed (with
+// hashes), then print its status line, its held-back diagnostics and its
+// validation result. Returns 1 if it was written.
+static int finishOutput(PendingOutput *pending, const TranspileOptions *options, uint64_t *hash, int *hashKnown,
+                        double *seconds, TranspileStats *stats, int streamed, size_t sourceLength) {
+    const char *name = outputFormatNames[pending->format];
+    void (*status)(const char *format, ...) = options->toStdout ? reportError : reportStatus;
+    int ok = 1;
+    if (!pending->filename) return 1;
+
+    if (!pending->opened) {
+        reportError("Failed to open file %s for writing\n", pending->filename);
+        free(pending->filename);
+        return 0;
+    }
+
+    closeOutputWriter(pending);
+    int written = pending->written && !pending->async.failed;
+    if (pending->file && fclose(pending->file) != 0) written = 0;
+    if (stats) {
+        *seconds += statsClock() - pending->started - pending->validateSeconds;
+        stats->validateSeconds += pending->validateSeconds;
+        stats->bytesWritten += pending->out.sent;
+        if (streamed) stats->bytesRead += sourceLength;
+    }
+
+    int changed = 1;
+    if (hash) {
+        if (written) changed = writeIfChanged(pending->filename, &pending->rendered, hash, hashKnown);
+        if (changed < 0) written = 0;
+        writerClose(&pending->rendered);
+    }
+
+    if (!written) {
+        reportReplay(&pending->diagnostics);
+        reportError("Failed to write %s\n", pending->filename);
+        ok = 0;
+    }
+    
+    else {
+        if (options->toStdout) {
+            // The output itself is the only thing printed to stdout
+        } else if (changed) {
+            reportStatus("Transpiled to %s: %s\n", name, pending->filename);
+        } else {
+            reportStatus("Unchanged %s: %s\n", name, pending->filename);
+        }
+        reportReplay(&pending->diagnostics);
+
+        if (pending->check) {
+            int valid = pending->format == OUTPUT_JSON ? jsonValidatorFinish(&pending->jsonValidator)
+                                                       : yamlValidatorFinish(&pending->yamlValidator);
+            if (valid) {
+                status("%s validation passed for %s\n", name, pending->filename);
+            } else {
+                status("Warning: %s validation failed for %s\n", name, pending->filename);
+            }
+        }
+    }
+    free(pending->yamlValidator.line);
+    free(pending->yamlValidator.indentLevels);
+    writerClose(&pending->diagnostics.log);
+    free(pending->filename);
+    return ok;
+}
+
+// Function to transpile a loaded document to the requested formats. With
+// hashes (watch mode) each output is rendered in memory first and only
+// written when its content changed. With toStdout the outputs go to stdout
+// one after another, and status lines move to stderr. With stats, the time
+// and bytes of each output are added to it. Returns 1 when every output was
+// written.
+int transpileDocument(ConfigDocument *document, const char *filename, const TranspileOptions *options, OutputHashes *hashes, TranspileStats *stats) {
+    ConfigItem *config = document->root;
+    ConfigItem *tree = config;     // for a streamed or compiled document, built when a format needs one
+    void (*status)(const char *format, ...) = options->toStdout ? reportError : reportStatus;
+    Report *job = activeReport;
+    int ok = 1;
+
+    // Compile to the binary format, which loads without parsing
+    if (options->compile && document->compiled.nodes) {
+        status("Skipping compilation of %s: already compiled\n", filename);
+    }
+
+    else if (options->compile) {
+        double started = stats ? statsClock() : 0;
+
+        // A streamed document has no tree, so compiling builds one
+        if (!tree) tree = parseV2ConfigMapped(document->streamFilename, &document->arena);
+        char *compiledFilename = tree ? outputName(filename, ".v2c", options) : NULL;
+        FILE *compiledFile = compiledFilename && !options->toStdout ? fopen(compiledFilename, "wb") : NULL;
+        if (compiledFile || (compiledFilename && options->toStdout)) {
+            OutputWriter out;
+            if (compiledFile) {
+                writerInitFile(&out, compiledFile);
+            }
+
+            else {
+                writerInitSink(&out, writerSinkStdout, job);
+            }
+            int written = compileConfigToWriter(tree, &out);
+            if (!writerClose(&out)) written = 0;
+            if (compiledFile && fclose(compiledFile) != 0) written = 0;
+            if (stats) {
+                stats->compileSeconds += statsClock() - started;
+                stats->bytesWritten += out.sent;
+                if (!config) stats->bytesRead += document->sourceLength;
+            }
+
+            if (!written) {
+                reportError("Failed to write %s\n", compiledFilename);
+                ok = 0;
+            }
+
+            else if (compiledFile) {
+                reportStatus("Compiled to %s\n", compiledFilename);
+            }
+        }
+
+        else {
+            if (compiledFilename) reportError("Failed to open file %s for writing\n", compiledFilename);
+            ok = 0;
+        }
+        free(compiledFilename);
+    }
+
+    // Serialize to JSON, YAML, MessagePack and CBOR. When JSON and YAML
+    // both go to files with nothing else to do on them, one walk of the tree
+    // writes both, and a background thread writes them to disk meanwhile.
+    int requested[OUTPUT_FORMATS] = {
+        options->transpileJSON, options->transpileYAML, options->transpileMsgPack, options->transpileCBOR
+    };
+    double noSeconds = 0;
+    double *outputSeconds[OUTPUT_FORMATS] = {
+        stats ? &stats->jsonSeconds : &noSeconds, stats ? &stats->yamlSeconds : &noSeconds,
+        stats ? &stats->msgpackSeconds : &noSeconds, stats ? &stats->cborSeconds : &noSeconds
+    };
+    int jsonStyle = (options->checkDesign ? JSON_TYPED : 0) | (options->compactJSON ? JSON_COMPACT : 0);
+    PendingOutput outputs[OUTPUT_FORMATS];
+    AsyncWriter async;
+    int fanOut = config && requested[OUTPUT_JSON] && requested[OUTPUT_YAML] && !hashes && !options->toStdout && !stats;
+
+    if (fanOut && asyncWriterStart(&async)) {
+        JSONFanOut json = { &outputs[OUTPUT_JSON].out, jsonStyle, 0 };
+        FanOutTarget targets[OUTPUT_FORMATS];
+        size_t targetCount = 0;
+        if (beginOutput(&outputs[OUTPUT_JSON], OUTPUT_JSON, filename, options, 0, 0, &async, job)) {
+            targets[targetCount++] = (FanOutTarget){ &jsonFanOut, &json };
+        }
+        if (beginOutput(&outputs[OUTPUT_YAML], OUTPUT_YAML, filename, options, 0, 0, &async, job)) {
+            targets[targetCount++] = (FanOutTarget){ &yamlFanOut, &outputs[OUTPUT_YAML].out };
+        }
+        if (targetCount > 0) {
+            // Anything the walk itself reports is held back with the first output
+            PendingOutput *first = outputs[OUTPUT_JSON].opened ? &outputs[OUTPUT_JSON] : &outputs[OUTPUT_YAML];
+            Report *previous = reportRedirect(&first->diagnostics);
+            emitFanOut(config, targets, targetCount);
+            reportRedirect(previous);
+        }
+        for (int format = OUTPUT_JSON; format <= OUTPUT_YAML; format++) {
+            if (outputs[format].opened) closeOutputWriter(&outputs[format]);
+        }
+        asyncWriterStop(&async);
+        for (int format = OUTPUT_JSON; format <= OUTPUT_YAML; format++) {
+            if (!finishOutput(&outputs[format], options, NULL, NULL, &noSeconds, NULL, 0, 0)) ok = 0;
+            requested[format] = 0;
+        }
+    }
+
+    for (int format = 0; format < OUTPUT_FORMATS; format++) {
+        if (!requested[format]) continue;
+        PendingOutput *pending = &outputs[format];
+        if (beginOutput(pending, format, filename, options, hashes != NULL, stats != NULL, NULL, job)) {
+            Report *previous = reportRedirect(&pending->diagnostics);
+            OutputWriter *out = &pending->out;
+            if (format == OUTPUT_MSGPACK || format == OUTPUT_CBOR) {
+                // A map starts with its size, so a streamed or compiled document needs a tree here too
+                if (!tree) {
+                    tree = document->compiled.nodes ? documentTree(document)
+                                                    : parseV2ConfigMapped(document->streamFilename, &document->arena);
+                }
+                if (tree) {
+                    serializeBinaryToWriter(tree, out, format == OUTPUT_MSGPACK ? BINARY_MSGPACK : BINARY_CBOR,
+                                            options->checkDesign);
+                }
+
+                else {
+                    out->failed = 1;
+                }
+            }
+
+            else if (format == OUTPUT_JSON && document->compiled.nodes) {
+                serializeCompiledJSONToWriter(&document->compiled, 0, out, 0, jsonStyle);
+            }
+
+            else if (format == OUTPUT_JSON && config) {
+                serializeJSONToWriter(config, out, 0, jsonStyle);
+            }
+
+            else if (format == OUTPUT_JSON) {
+                streamJSON(document->streamFilename, document->duplicates, document->duplicateCount,
+                           out, jsonStyle);
+            }
+
+            else if (document->compiled.nodes) {
+                serializeCompiledYAMLToWriter(&document->compiled, 0, out, 0);
+            }
+
+            else if (config) {
+                serializeYAMLToWriter(config, out, 0);
+            }
+
+            else {
+                streamYAML(document->streamFilename, out);
+            }
+            closeOutputWriter(pending);
+            reportRedirect(previous);
+        }
+        if (!finishOutput(pending, options, hashes ? &hashes->hash[format] : NULL, hashes ? &hashes->known[format] : NULL,
+                          outputSeconds[format], stats, document->streamFilename != NULL, document->sourceLength)) {
+            ok = 0;
+        }
+    }
+    return ok;
+}
+
+// Function to transpile one .v2 file to the requested formats; returns 1 on success
+int transpileFile(const char *filename, const TranspileOptions *options, TranspileStats *stats) {
+    double started = stats ? statsClock() : 0;
+    ConfigDocument *document = loadV2Document(filename, options->parser);
+    if (!document) {
+        reportError("Failed to parse %s\n", filename);
+
+        // The file still counts, with the time and the bytes it took to fail
+        if (stats) {
+            stats->parseSeconds += statsClock() - started;
+#ifndef _WIN32
+            struct stat info;
+            if (!isStandardStream(filename) && stat(filename, &info) == 0 && S_ISREG(info.st_mode)) {
+                stats->bytesRead += (uint64_t)info.st_size;
+            }
+#endif
+            stats->files++;
+            stats->failed++;
+            printStats(options->toStdout ? reportError : reportStatus, filename, stats);
+        }
+        return 0;
+    }
+    if (stats) {
+        stats->parseSeconds += statsClock() - started;
+        stats->bytesRead += document->sourceLength;
+    }
+
+    int ok = transpileDocument(document, filename, options, NULL, stats);
+    if (stats) {
+        stats->nodes += document->compiled.nodes ? document->compiled.nodeCount : countNodes(document->root);
+        stats->treeBytes = arenaUsage(&document->arena, &stats->allocations);
+        stats->files++;
+        if (!ok) stats->failed++;
+        printStats(options->toStdout ? reportError : reportStatus, filename, stats);
+    }
+    freeConfigDocument(document);
+    return ok;
+}
+
+// Function to validate an existing .json or .yaml file; returns 1 when it passes
+int validateFile(const char *filename) {
+    const char *dot = strrchr(filename, '.');
+    if (dot && strcmp(dot, ".json") == 0) {
+        if (checkDesignJSON(filename)) {
+            reportStatus("JSON validation passed for %s\n", filename);
+            return 1;
+        }
+        reportStatus("Warning: JSON validation failed for %s\n", filename);
+        return 0;
+    }
+
+    if (dot && (strcmp(dot, ".yaml") == 0 || strcmp(dot, ".yml") == 0)) {
+        if (checkDesignYAML(filename)) {
+            reportStatus("YAML validation passed for %s\n", filename);
+            return 1;
+        }
+        reportStatus("Warning: YAML validation failed for %s\n", filename);
+        return 0;
+    }
+
+    reportError("Cannot validate %s: expected a .json, .yaml or .yml file\n", filename);
+    return 0;
+}
+
+// Persistent build cache (--cache). Each input is recorded with a hash of its
+// bytes seeded by the options that shape its outputs, plus the size and
+// modification time of every output written for it. A file whose hash still
+// matches and whose outputs are untouched is skipped without being parsed.
+#define CACHE_VERSION 1
+#define CACHE_DEFAULT_FILE ".v2cache"
+#define CACHE_MAX_OUTPUTS 5
+
+typedef struct CachedOutput {
+    uint64_t size;
+    int64_t modified;      // nanoseconds since the epoch
+} CachedOutput;
+
+typedef struct CacheEntry {
+    char *filename;
+    uint64_t key;
+    int outputCount;
+    CachedOutput outputs[CACHE_MAX_OUTPUTS];
+} CacheEntry;
+
+typedef struct BuildCache {
+    const char *path;
+    CacheEntry *entries;   // sorted by filename
+    size_t count;
+} BuildCache;
+
+// Function to get the size and modification time of a file
+static int fileStamp(const char *filename, CachedOutput *stamp) {
+#ifndef _WIN32
+    struct stat info;
+    if (stat(filename, &info) != 0 || !S_ISREG(info.st_mode)) return 0;
+    stamp->size = (uint64_t)info.st_size;
+#ifdef __APPLE__
+    stamp->modified = (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+    stamp->modified = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+    return 1;
+#else
+    (void)filename;
+    (void)stamp;
+    return 0;
+#endif
+}
+
+// Function to list the outputs the options ask for, in a fixed order; returns their count
+static int cacheOutputNames(const char *filename, const TranspileOptions *options, char *names[CACHE_MAX_OUTPUTS]) {
+    int count = 0;
+    if (options->compile) names[count++] = outputFilename(filename, ".v2c");
+    if (options->transpileJSON) names[count++] = outputFilename(filename, ".json");
+    if (options->transpileYAML) names[count++] = outputFilename(filename, ".yaml");
+    if (options->transpileMsgPack) names[count++] = outputFilename(filename, ".msgpack");
+    if (options->transpileCBOR) names[count++] = outputFilename(filename, ".cbor");
+    return count;
+}
+
+// Function to hash an input file together with the options that shape its outputs
+static int cacheKey(const char *filename, const TranspileOptions *options, uint64_t *key) {
+    SourceBuffer source;
+    if (!openSourceBuffer(filename, &source)) return 0;
+
+    uint64_t flags[9] = {
+        CACHE_VERSION,
+        (uint64_t)options->transpileJSON,
+        (uint64_t)options->transpileYAML,
+        (uint64_t)options->transpileMsgPack,
+        (uint64_t)options->transpileCBOR,
+        (uint64_t)options->compactJSON,
+        (uint64_t)options->checkDesign,
+        (uint64_t)options->checkYAML,
+        (uint64_t)options->compile
+    };
+    *key = hashContent(source.data, source.length, hashContent(flags, sizeof(flags), 0));
+    closeSourceBuffer(&source);
+    return 1;
+}
+
+static int compareCacheEntries(const void *a, const void *b) {
+    return strcmp(((const CacheEntry *)a)->filename, ((const CacheEntry *)b)->filename);
+}
+
+// Function to find the cache entry of an input file
+static const CacheEntry *cacheFind(const BuildCache *cache, const char *filename) {
+    CacheEntry probe;
+    probe.filename = (char *)filename;
+    return (const CacheEntry *)bsearch(&probe, cache->entries, cache->count, sizeof(CacheEntry), compareCacheEntries);
+}
+
+// Function to load the cache file; a missing or unreadable one gives an empty cache
+void loadBuildCache(BuildCache *cache, const char *path) {
+    cache->path = path;
+    cache->entries = NULL;
+    cache->count = 0;
+
+    FILE *file = fopen(path, "r");
+    if (!file) return;
+
+    char line[4096];
+    int version = 0;
+    if (!fgets(line, sizeof(line), file) || sscanf(line, "v2cache %d", &version) != 1 || version != CACHE_VERSION) {
+        fclose(file);
+        return;
+    }
+
+    size_t capacity = 0;
+    while (fgets(line, sizeof(line), file)) {
+        size_t length = strlen(line);
+        if (length == 0 || line[length - 1] != '\n') continue;
+        line[--length] = '\0';
+
+        CacheEntry entry;
+        unsigned long long key;
+        int consumed = 0;
+        if (sscanf(line, "%16llx %d%n", &key, &entry.outputCount, &consumed) != 2 ||
+            entry.outputCount < 0 || entry.outputCount > CACHE_MAX_OUTPUTS) continue;
+
+        const char *p = line + consumed;
+        int valid = 1;
+        for (int i = 0; i < entry.outputCount && valid; i++) {
+            unsigned long long size;
+            long long modified;
+            int used = 0;
+            valid = sscanf(p, " %llu %lld%n", &size, &modified, &used) == 2;
+            entry.outputs[i].size = size;
+            entry.outputs[i].modified = modified;
+            p += used;
+        }
+        if (!valid || *p != ' ' || p[1] == '\0') continue;
+
+        if (cache->count == capacity) {
+            size_t newCapacity = capacity ? capacity * 2 : 64;
+            CacheEntry *grown = (CacheEntry *)realloc(cache->entries, newCapacity * sizeof(CacheEntry));
+            if (!grown) break;
+            cache->entries = grown;
+            capacity = newCapacity;
+        }
+        entry.key = key;
+        entry.filename = strdup(p + 1);
+        if (!entry.filename) break;
+        cache->entries[cache->count++] = entry;
+    }
+    fclose(file);
+    if (cache->count > 1) qsort(cache->entries, cache->count, sizeof(CacheEntry), compareCacheEntries);
+}
+
+// Function to check whether an input can be skipped. When it cannot, the key
+// is left in entry so the outputs can be recorded once they are written.
+int cacheCheck(const BuildCache *cache, const char *filename, const TranspileOptions *options, CacheEntry *entry) {
+    entry->filename = NULL;
+    entry->outputCount = 0;
+    if (!cacheKey(filename, options, &entry->key)) return 0;
+
+    const CacheEntry *cached = cacheFind(cache, filename);
+    if (!cached || cached->key != entry->key) return 0;
+
+    char *names[CACHE_MAX_OUTPUTS];
+    int count = cacheOutputNames(filename, options, names);
+    int intact = count == cached->outputCount;
+    for (int i = 0; i < count; i++) {
+        CachedOutput stamp;
+        if (intact) {
+            intact = names[i] && fileStamp(names[i], &stamp) &&
+                     stamp.size == cached->outputs[i].size && stamp.modified == cached->outputs[i].modified;
+        }
+        free(names[i]);
+    }
+    return intact;
+}
+
+// Function to record the outputs just written for an input
+int cacheRecord(const char *filename, const TranspileOptions *options, CacheEntry *entry) {
+    char *names[CACHE_MAX_OUTPUTS];
+    int count = cacheOutputNames(filename, options, names);
+    int recorded = 1;
+    for (int i = 0; i < count; i++) {
+        if (recorded) recorded = names[i] && fileStamp(names[i], &entry->outputs[i]);
+        free(names[i]);
+    }
+    entry->outputCount = count;
+    entry->filename = recorded ? strdup(filename) : NULL;
+    return entry->filename != NULL;
+}
+
+// Function to merge new entries (whose filenames it takes over) into the cache and write it back
+int saveBuildCache(BuildCache *cache, CacheEntry *updates, size_t count) {
+    CacheEntry *merged = (CacheEntry *)malloc((cache->count + count + 1) * sizeof(CacheEntry));
+    if (!merged) {
+        reportError("Memory allocation failed\n");
+        return 0;
+    }
+
+    // Merge the two sorted lists; a new entry replaces the old one for the same file
+    size_t fresh = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (updates[i].filename) updates[fresh++] = updates[i];
+    }
+    if (fresh > 1) qsort(updates, fresh, sizeof(CacheEntry), compareCacheEntries);
+
+    size_t total = 0;
+    size_t old = 0;
+    for (size_t i = 0; i < fresh; i++) {
+        if (i + 1 < fresh && strcmp(updates[i].filename, updates[i + 1].filename) == 0) {
+            free(updates[i].filename);
+            continue;
+        }
+        while (old < cache->count && strcmp(cache->entries[old].filename, updates[i].filename) < 0) {
+            merged[total++] = cache->entries[old++];
+        }
+        if (old < cache->count && strcmp(cache->entries[old].filename, updates[i].filename) == 0) {
+            free(cache->entries[old++].filename);
+        }
+        merged[total++] = updates[i];
+    }
+    while (old < cache->count) {
+        merged[total++] = cache->entries[old++];
+    }
+
+    size_t length = strlen(cache->path);
+    char *temporary = (char *)malloc(length + 5);
+    FILE *file = NULL;
+    if (temporary) {
+        memcpy(temporary, cache->path, length);
+        memcpy(temporary + length, ".tmp", 5);
+        file = fopen(temporary, "w");
+    }
+
+    int saved = file != NULL;
+    if (file) {
+        fprintf(file, "v2cache %d\n", CACHE_VERSION);
+        for (size_t i = 0; i < total; i++) {
+            const CacheEntry *entry = &merged[i];
+            if (strchr(entry->filename, '\n')) continue;
+            fprintf(file, "%016llx %d", (unsigned long long)entry->key, entry->outputCount);
+            for (int o = 0; o < entry->outputCount; o++) {
+                fprintf(file, " %llu %lld", (unsigned long long)entry->outputs[o].size, (long long)entry->outputs[o].modified);
+            }
+            fprintf(file, " %s\n", entry->filename);
+        }
+        if (fclose(file) != 0) saved = 0;
+        if (saved && rename(temporary, cache->path) != 0) saved = 0;
+        if (!saved) remove(temporary);
+    }
+    if (!saved) {
+        reportError("Failed to write build cache %s\n", cache->path);
+    }
+
+    // The merged list now owns every filename
+    for (size_t i = 0; i < total; i++) {
+        free(merged[i].filename);
+    }
+    free(merged);
+    free(temporary);
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->count = 0;
+    return saved;
+}
+
+// One input file of a run, with its output captured while a worker handles it
+typedef struct TranspileJob {
+    const char *filename;
+    TranspileOptions options;
+    Report report;
+    const BuildCache *cache;
+    CacheEntry cacheEntry;     // what to record for this file once it is written
+    TranspileStats stats;
+    int cacheHit;
+    int done;
+    int failed;
+} TranspileJob;
+
+// Function to run one job: transpile the file (unless the cache says it is
+// up to date), or validate it with --validate
+static void runJob(TranspileJob *job) {
+    if (job->options.validateOnly) {
+        job->failed = !validateFile(job->filename);
+    }
+    
+    else if (job->cache && !job->options.toStdout) {
+        if (cacheCheck(job->cache, job->filename, &job->options, &job->cacheEntry)) {
+            job->cacheHit = 1;
+            reportStatus("Up to date: %s\n", job->filename);
+        }
+        
+        else if (transpileFile(job->filename, &job->options, job->options.stats ? &job->stats : NULL)) {
+            cacheRecord(job->filename, &job->options, &job->cacheEntry);
+        }
+    }
+    
+    else {
+        transpileFile(job->filename, &job->options, job->options.stats ? &job->stats : NULL);
+    }
+}
+
+// Work shared by the worker pool: jobs are handed out in command-line order
+typedef struct JobQueue {
+    TranspileJob *jobs;
+    size_t count;
+    size_t next;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+} JobQueue;
+
+static void *transpileWorker(void *arg) {
+    JobQueue *queue = (JobQueue *)arg;
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        if (queue->next == queue->count) {
+            pthread_mutex_unlock(&queue->lock);
+            break;
+        }
+        TranspileJob *job = &queue->jobs[queue->next++];
+        pthread_mutex_unlock(&queue->lock);
+
+        reportRedirect(&job->report);
+        runJob(job);
+        reportRedirect(NULL);
+
+        pthread_mutex_lock(&queue->lock);
+        job->done = 1;
+        pthread_cond_broadcast(&queue->finished);
+        pthread_mutex_unlock(&queue->lock);
+    }
+    return NULL;
+}
+
+// Function to transpile a batch of files on up to `threads` workers.
+// Each file's status lines and errors are printed together, in input order.
+void runTranspileJobs(TranspileJob *jobs, size_t count, int threads) {
+    if ((size_t)threads > count) threads = (int)count;
+
+    pthread_t *workers = NULL;
+    int started = 0;
+    JobQueue queue;
+    queue.jobs = jobs;
+    queue.count = count;
+    queue.next = 0;
+
+    if (threads > 1) {
+        selectJSONEscapeKernel();
+        pthread_mutex_init(&queue.lock, NULL);
+        pthread_cond_init(&queue.finished, NULL);
+        workers = (pthread_t *)malloc((size_t)threads * sizeof(pthread_t));
+        for (int t = 0; workers && t < threads; t++) {
+            if (pthread_create(&workers[t], NULL, transpileWorker, &queue) != 0) break;
+            started++;
+        }
+    }
+
+    // Without workers, handle every file right here, printing as we go
+    if (started == 0) {
+        for (size_t i = 0; i < count; i++) {
+            runJob(&jobs[i]);
+        }
     }
     
-    return !error;
+    else {
+        for (size_t i = 0; i < count; i++) {
+            pthread_mutex_lock(&queue.lock);
+            while (!jobs[i].done) {
+                pthread_cond_wait(&queue.finished, &queue.lock);
+            }
+            pthread_mutex_unlock(&queue.lock);
+
+            reportReplay(&jobs[i].report);
+            writerClose(&jobs[i].report.log);
+        }
+
+        for (int t = 0; t < started; t++) {
+            pthread_join(workers[t], NULL);
+        }
+    }
+
+    if (threads > 1) {
+        pthread_cond_destroy(&queue.finished);
+        pthread_mutex_destroy(&queue.lock);
+    }
+    free(workers);
+}
+
+// Function to count the online CPUs (for -j 0)
+int onlineCPUs(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0) return (int)cpus;
+#endif
+    return 1;
+}
+
+// A .v2 file kept loaded by --watch, with what was last written for it
+typedef struct WatchedFile {
+    const char *filename;
+    const char *name;           // filename without its directory
+    TranspileOptions options;
+    ConfigDocument *document;
+    uint64_t sourceHash;
+    OutputHashes outputs;
+    int directory;              // inotify watch on the containing directory
+    int dirty;
+} WatchedFile;
+
+// How long to wait for the rest of an editor's save before acting on it
+#define WATCH_SETTLE_MS 50
+
+// Function to re-parse a watched file if its bytes changed and rewrite the outputs that changed
+static void refreshWatchedFile(WatchedFile *file) {
+    SourceBuffer source;
+    if (!openSourceBuffer(file->filename, &source)) {
+        reportError("Failed to open file %s\n", file->filename);
+        return;
+    }
+    uint64_t sourceHash = hashContent(source.data, source.length, 0);
+    closeSourceBuffer(&source);
+    if (file->document && sourceHash == file->sourceHash) return;
+
+    // On a parse error the previous tree stays loaded until the next save
+    ConfigDocument *document = loadV2Document(file->filename, file->options.parser);
+    if (!document) {
+        reportError("Failed to parse %s\n", file->filename);
+        return;
+    }
+    freeConfigDocument(file->document);
+    file->document = document;
+    file->sourceHash = sourceHash;
+    transpileDocument(document, file->filename, &file->options, &file->outputs, NULL);
+}
+
+// Function to transpile the jobs' files, then keep them loaded and redo
+// each one whenever it is saved. Only returns on error.
+int watchFiles(TranspileJob *jobs, size_t count) {
+#ifdef __linux__
+    int fd = inotify_init1(IN_CLOEXEC);
+    WatchedFile *files = (WatchedFile *)calloc(count + 1, sizeof(WatchedFile));
+    if (fd < 0 || !files) {
+        reportError("Failed to start watching files\n");
+        if (fd >= 0) close(fd);
+        free(files);
+        return 1;
+    }
+
+    // Watch directories rather than files, so saves that replace the file are seen
+    size_t watched = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (jobs[i].options.validateOnly) continue;
+
+        WatchedFile *file = &files[watched];
+        const char *slash = strrchr(jobs[i].filename, '/');
+        char *directory = slash ? strdup(jobs[i].filename) : strdup(".");
+        if (!directory) {
+            reportError("Memory allocation failed\n");
+            continue;
+        }
+        if (slash) directory[slash == jobs[i].filename ? 1 : slash - jobs[i].filename] = '\0';
+
+        file->filename = jobs[i].filename;
+        file->name = slash ? slash + 1 : jobs[i].filename;
+        file->options = jobs[i].options;
+        file->directory = inotify_add_watch(fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (file->directory < 0) {
+            reportError("Failed to watch %s\n", directory);
+            free(directory);
+            continue;
+        }
+        free(directory);
+
+        refreshWatchedFile(file);
+        watched++;
+    }
+
+    if (watched == 0) {
+        reportError("No .v2 files to watch\n");
+        close(fd);
+        free(files);
+        return 1;
+    }
+    reportStatus("Watching %zu file%s for changes\n", watched, watched == 1 ? "" : "s");
+    fflush(stdout);
+
+    char buffer[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+
+        // Editors save in several steps; take in whatever follows within a moment
+        while (length > 0) {
+            for (char *p = buffer; p < buffer + length; ) {
+                struct inotify_event *event = (struct inotify_event *)p;
+                for (size_t i = 0; i < watched; i++) {
+                    if (event->mask & IN_Q_OVERFLOW) {
+                        files[i].dirty = 1;
+                    }
+                    
+                    else if (event->len && files[i].directory == event->wd && strcmp(files[i].name, event->name) == 0) {
+                        files[i].dirty = 1;
+                    }
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+
+            struct pollfd pending = { fd, POLLIN, 0 };
+            if (poll(&pending, 1, WATCH_SETTLE_MS) <= 0) break;
+            length = read(fd, buffer, sizeof(buffer));
+        }
+        if (length < 0 && errno != EINTR) {
+            reportError("Failed to read file changes\n");
+            break;
+        }
+
+        for (size_t i = 0; i < watched; i++) {
+            if (files[i].dirty) {
+                files[i].dirty = 0;
+                refreshWatchedFile(&files[i]);
+            }
+        }
+        fflush(stdout);
+    }
+
+    for (size_t i = 0; i < watched; i++) {
+        freeConfigDocument(files[i].document);
+    }
+    free(files);
+    close(fd);
+    return 1;
+#else
+    (void)jobs;
+    (void)count;
+    reportError("--watch is only supported on Linux\n");
+    return 1;
+#endif
+}
+
+// Server mode (--serve). Clients connect to a Unix socket and send framed
+// requests (see v2.h). The main thread multiplexes every connection with
+// epoll and hands each complete request to a pool of worker threads. A
+// connection has at most one request with the workers at a time, and is not
+// read from meanwhile, so its replies go out in the order it asked.
+enum {
+    SERVE_READING,              // waiting for the rest of a request
+    SERVE_WORKING,              // the request is with a worker
+    SERVE_SENDING               // the reply is going out
+};
+
+typedef struct ServeConnection {
+    int fd;
+    int state;
+    int hungUp;                 // the peer went away while a worker had its request
+    int closed;                 // closed by serveClose, freed after the current batch of events
+    char *input;                // bytes received, starting with the current frame
+    size_t inputLength;
+    size_t inputCapacity;
+    OutputWriter reply;         // the reply frame, built by a worker
+    size_t replySent;
+    struct ServeConnection *next;       // in the work queue or the finished list
+    struct ServeConnection *previousOpen;
+    struct ServeConnection *nextOpen;
+} ServeConnection;
+
+typedef struct Server {
+    int epoll;
+    int listener;
+    int wake;                   // eventfd written by workers when a reply is ready
+    int signals;                // signalfd for SIGINT and SIGTERM
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    ServeConnection *queueHead;
+    ServeConnection *queueTail;
+    ServeConnection *finished;
+    ServeConnection *open;      // every connection, for shutting down
+    ServeConnection *closed;    // closed while handling a batch of events, not yet freed
+    int stopping;
+} Server;
+
+#define SERVE_READ_SIZE (64 * 1024)
+
+#ifdef __linux__
+// Function to read the body length from a frame header
+static size_t frameLength(const char *header) {
+    const unsigned char *bytes = (const unsigned char *)header;
+    return ((size_t)bytes[1] << 24) | ((size_t)bytes[2] << 16) | ((size_t)bytes[3] << 8) | bytes[4];
 }
 
-// Function to serialize a ConfigItem to YAML
-void serializeYAML(ConfigItem *item, FILE *file, int indent) {
-    if (!item) return;
+// Function to fill in a frame header
+static void frameHeader(char *header, char type, size_t length) {
+    header[0] = type;
+    header[1] = (char)(length >> 24);
+    header[2] = (char)(length >> 16);
+    header[3] = (char)(length >> 8);
+    header[4] = (char)length;
+}
 
-    ConfigItem *child = item->child;
-    while (child) {
-        for (int i = 0; i < indent; ++i) fprintf(file, "  ");
-        
-        // For YAML, we need to properly quote strings with special characters
-        if (child->value) {
-            // Check if value needs quoting (contains special chars)
-            int needsQuotes = 0;
-            const char *specialChars = ":#{}[]&*!|>'\",";
-            for (const char *c = child->value; *c; c++) {
-                if (strchr(specialChars, *c) || *c <= ' ') {
-                    needsQuotes = 1;
-                    break;
-                }
+// Function to answer the request at the front of a connection's input.
+// Diagnostics from parsing become the body of an error reply.
+static void serveRequest(ServeConnection *connection) {
+    char type = connection->input[0];
+    const char *source = connection->input + V2_FRAME_HEADER;
+    size_t length = frameLength(connection->input);
+
+    Report diagnostics;
+    writerInitMemory(&diagnostics.log);
+    Report *previous = reportRedirect(&diagnostics);
+
+    OutputWriter *reply = &connection->reply;
+    writerInitMemory(reply);
+    writerWrite(reply, "\0\0\0\0\0", V2_FRAME_HEADER);
+
+    Arena arena;
+    arenaInit(&arena);
+    CompiledConfig compiled;
+    memset(&compiled, 0, sizeof(compiled));
+    ConfigItem *root = NULL;
+    int flat = 0;
+
+    if (type != V2_FRAME_JSON && type != V2_FRAME_YAML && type != V2_FRAME_MSGPACK && type != V2_FRAME_CBOR &&
+        type != V2_FRAME_COMPILE) {
+        reportError("Unknown request type 0x%02x\n", (unsigned char)type);
+    }
+
+    else if (isCompiledConfig(source, length)) {
+        // The node table is read in place, so it needs an aligned copy
+        char *copy = (char *)malloc(length);
+        if (copy) {
+            memcpy(copy, source, length);
+            compiled.source.data = copy;
+            compiled.source.length = length;
+            if (!loadCompiledConfig(&compiled)) {
+                reportError("Invalid compiled configuration\n");
             }
-            
-            if (needsQuotes) {
-                fprintf(file, "%s: \"", child->key);
-                // Escape double quotes in the value
-                for (const char *c = child->value; *c; c++) {
-                    if (*c == '"') fprintf(file, "\\\"");
-                    else fprintf(file, "%c", *c);
-                }
-                fprintf(file, "\"\n");
+
+            // JSON and YAML are written straight from the node table
+            else if (type == V2_FRAME_JSON || type == V2_FRAME_YAML) {
+                flat = 1;
             }
-            
+
             else {
-                fprintf(file, "%s: %s\n", child->key, child->value);
+                root = compiledToConfigItems(&compiled, &arena);
             }
         }
-        
+
         else {
-            fprintf(file, "%s:\n", child->key);
-            serializeYAML(child, file, indent + 1);
+            reportError("Memory allocation failed\n");
         }
-        child = child->next;
     }
+
+    else {
+        root = parseV2Buffer(source, length, &arena);
+    }
+
+    int ok = root != NULL || flat;
+    if (ok && type == V2_FRAME_JSON) {
+        if (flat) serializeCompiledJSONToWriter(&compiled, 0, reply, 0, 0);
+        else serializeJSONToWriter(root, reply, 0, 0);
+    }
+
+    else if (ok && type == V2_FRAME_YAML) {
+        if (flat) serializeCompiledYAMLToWriter(&compiled, 0, reply, 0);
+        else serializeYAMLToWriter(root, reply, 0);
+    }
+
+    else if (ok && (type == V2_FRAME_MSGPACK || type == V2_FRAME_CBOR)) {
+        serializeBinaryToWriter(root, reply, type == V2_FRAME_MSGPACK ? BINARY_MSGPACK : BINARY_CBOR, 0);
+    }
+
+    else if (ok) {
+        ok = compileConfigToWriter(root, reply);
+    }
+    reportRedirect(previous);
+
+    if (!ok && !reply->failed) {
+        reply->length = V2_FRAME_HEADER;
+        reportCopyText(&diagnostics, reply);
+        if (reply->length == V2_FRAME_HEADER) writerPutString(reply, "Failed to parse request\n");
+    }
+    if (!reply->failed) frameHeader(reply->buffer, ok ? V2_FRAME_OK : V2_FRAME_ERROR, reply->length - V2_FRAME_HEADER);
+
+    if (compiled.source.data) closeCompiledConfig(&compiled);
+    arenaRelease(&arena);
+    writerClose(&diagnostics.log);
 }
 
-// Function to remove file extension and add new extension
-void changeFileExtension(const char *input, char *output, const char *newExt) {
-    strcpy(output, input);
-    char *dot = strrchr(output, '.');
-    if (dot) {
-        strcpy(dot, newExt);
+static void *serveWorker(void *arg) {
+    Server *server = (Server *)arg;
+    for (;;) {
+        pthread_mutex_lock(&server->lock);
+        while (!server->queueHead && !server->stopping) {
+            pthread_cond_wait(&server->work, &server->lock);
+        }
+        ServeConnection *connection = server->queueHead;
+        if (!connection) {
+            pthread_mutex_unlock(&server->lock);
+            break;
+        }
+        server->queueHead = connection->next;
+        if (!server->queueHead) server->queueTail = NULL;
+        pthread_mutex_unlock(&server->lock);
+
+        serveRequest(connection);
+
+        pthread_mutex_lock(&server->lock);
+        connection->next = server->finished;
+        server->finished = connection;
+        pthread_mutex_unlock(&server->lock);
+
+        uint64_t one = 1;
+        if (write(server->wake, &one, sizeof(one)) < 0) {
+            // The counter is already non-zero, so the loop will wake anyway
+        }
     }
-    
-    else {
-        strcat(output, newExt);
+    return NULL;
+}
+
+// Function to close a connection and free it
+static void serveClose(Server *server, ServeConnection *connection) {
+    if (connection->previousOpen) connection->previousOpen->nextOpen = connection->nextOpen;
+    else server->open = connection->nextOpen;
+    if (connection->nextOpen) connection->nextOpen->previousOpen = connection->previousOpen;
+
+    if (!connection->hungUp) epoll_ctl(server->epoll, EPOLL_CTL_DEL, connection->fd, NULL);
+    close(connection->fd);
+
+    // Later events of the same epoll_wait batch may still point at it
+    connection->closed = 1;
+    connection->next = server->closed;
+    server->closed = connection;
+}
+
+// Function to free the connections closed since the last call
+static void serveFreeClosed(Server *server) {
+    while (server->closed) {
+        ServeConnection *connection = server->closed;
+        server->closed = connection->next;
+        free(connection->input);
+        free(connection->reply.buffer);
+        free(connection);
     }
 }
 
-// Function to interpret the configuration file
-void interpretConfig(ConfigItem *item, int indent) {
-    if (!item) return;
+// Function to choose which events to wait for on a connection
+static void serveInterest(Server *server, ServeConnection *connection, uint32_t events) {
+    struct epoll_event event;
+    event.events = events;
+    event.data.ptr = connection;
+    epoll_ctl(server->epoll, EPOLL_CTL_MOD, connection->fd, &event);
+}
 
-    ConfigItem *child = item->child;
-    while (child) {
-        for (int i = 0; i < indent; ++i) printf("  ");
-        if (child->value) {
-            printf("%s = %s\n", child->key, child->value);
+// Function to hand the next complete frame of a connection to the workers.
+// Returns 0 if the connection sent something that cannot be a frame.
+static int serveDispatch(Server *server, ServeConnection *connection) {
+    if (connection->inputLength < V2_FRAME_HEADER) return 1;
+    size_t length = frameLength(connection->input);
+    if (length > V2_FRAME_MAX) return 0;
+    if (connection->inputLength - V2_FRAME_HEADER < length) return 1;
+
+    // Stop reading until the reply has gone out
+    connection->state = SERVE_WORKING;
+    serveInterest(server, connection, 0);
+
+    pthread_mutex_lock(&server->lock);
+    connection->next = NULL;
+    if (server->queueTail) server->queueTail->next = connection;
+    else server->queueHead = connection;
+    server->queueTail = connection;
+    pthread_cond_signal(&server->work);
+    pthread_mutex_unlock(&server->lock);
+    return 1;
+}
+
+// Function to send as much of a connection's reply as the socket takes; once
+// all of it is out, the next request is started. Returns 0 to close it.
+static int serveSend(Server *server, ServeConnection *connection) {
+    while (connection->replySent < connection->reply.length) {
+        ssize_t sent = send(connection->fd, connection->reply.buffer + connection->replySent,
+                            connection->reply.length - connection->replySent, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            serveInterest(server, connection, EPOLLOUT);
+            return 1;
         }
-        
-        else {
-            printf("%s:\n", child->key);
-            interpretConfig(child, indent + 1);
+        if (sent <= 0) return 0;
+        connection->replySent += (size_t)sent;
+    }
+
+    // Drop the answered frame and go back to reading
+    size_t consumed = V2_FRAME_HEADER + frameLength(connection->input);
+    memmove(connection->input, connection->input + consumed, connection->inputLength - consumed);
+    connection->inputLength -= consumed;
+    writerClose(&connection->reply);
+    connection->replySent = 0;
+    connection->state = SERVE_READING;
+    serveInterest(server, connection, EPOLLIN);
+    return serveDispatch(server, connection);
+}
+
+// Function to read what a connection sent. Returns 0 to close it.
+static int serveReceive(Server *server, ServeConnection *connection) {
+    for (;;) {
+        if (connection->inputCapacity - connection->inputLength < SERVE_READ_SIZE) {
+            size_t capacity = connection->inputCapacity ? connection->inputCapacity * 2 : SERVE_READ_SIZE * 2;
+            char *grown = (char *)realloc(connection->input, capacity);
+            if (!grown) return 0;
+            connection->input = grown;
+            connection->inputCapacity = capacity;
         }
-        child = child->next;
+
+        ssize_t received = recv(connection->fd, connection->input + connection->inputLength,
+                                connection->inputCapacity - connection->inputLength, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (received <= 0) return 0;
+        connection->inputLength += (size_t)received;
+
+        // A whole request is in: leave anything after it in the socket
+        if (connection->inputLength >= V2_FRAME_HEADER &&
+            connection->inputLength - V2_FRAME_HEADER >= frameLength(connection->input)) {
+            break;
+        }
+    }
+    return serveDispatch(server, connection);
+}
+
+// Function to accept every pending connection
+static void serveAccept(Server *server) {
+    for (;;) {
+        int fd = accept(server->listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) reportError("Failed to accept a connection\n");
+            return;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        ServeConnection *connection = (ServeConnection *)calloc(1, sizeof(ServeConnection));
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = connection;
+        if (!connection || epoll_ctl(server->epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            free(connection);
+            continue;
+        }
+        connection->fd = fd;
+        connection->state = SERVE_READING;
+        connection->nextOpen = server->open;
+        if (server->open) server->open->previousOpen = connection;
+        server->open = connection;
+    }
+}
+
+// Function to send the replies the workers have finished
+static void serveFinished(Server *server) {
+    uint64_t count;
+    if (read(server->wake, &count, sizeof(count)) < 0) {
+        // Nothing to clear; take whatever is on the list
+    }
+
+    pthread_mutex_lock(&server->lock);
+    ServeConnection *connection = server->finished;
+    server->finished = NULL;
+    pthread_mutex_unlock(&server->lock);
+
+    while (connection) {
+        ServeConnection *next = connection->next;
+        connection->state = SERVE_SENDING;
+        if (connection->hungUp || connection->reply.failed || !serveSend(server, connection)) {
+            serveClose(server, connection);
+        }
+        connection = next;
+    }
+}
+
+// Function to listen on a Unix socket and answer transpile requests on
+// `workers` threads until SIGINT or SIGTERM. Returns the exit status.
+int serveRequests(const char *path, int workers) {
+    Server server;
+    memset(&server, 0, sizeof(server));
+    server.listener = -1;
+    server.wake = -1;
+    server.signals = -1;
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        reportError("Socket path too long: %s\n", path);
+        return 1;
+    }
+    strcpy(address.sun_path, path);
+
+    // A socket left behind by an earlier run is replaced; any other file is not
+    struct stat info;
+    if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode)) unlink(path);
+
+    // The signals are taken through the event loop, so every thread blocks them
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    server.listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    server.epoll = epoll_create1(EPOLL_CLOEXEC);
+    server.wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    server.signals = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (server.listener < 0 || server.epoll < 0 || server.wake < 0 || server.signals < 0 ||
+        bind(server.listener, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(server.listener, SOMAXCONN) != 0) {
+        reportError("Failed to listen on %s\n", path);
+        if (server.listener >= 0) close(server.listener);
+        if (server.epoll >= 0) close(server.epoll);
+        if (server.wake >= 0) close(server.wake);
+        if (server.signals >= 0) close(server.signals);
+        return 1;
+    }
+
+    // The special descriptors are told apart from connections by their pointers
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &server.listener;
+    epoll_ctl(server.epoll, EPOLL_CTL_ADD, server.listener, &event);
+    event.data.ptr = &server.wake;
+    epoll_ctl(server.epoll, EPOLL_CTL_ADD, server.wake, &event);
+    event.data.ptr = &server.signals;
+    epoll_ctl(server.epoll, EPOLL_CTL_ADD, server.signals, &event);
+
+    selectJSONEscapeKernel();
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.work, NULL);
+    pthread_t *threads = (pthread_t *)malloc((size_t)workers * sizeof(pthread_t));
+    int started = 0;
+    for (int t = 0; threads && t < workers; t++) {
+        if (pthread_create(&threads[t], NULL, serveWorker, &server) != 0) break;
+        started++;
+    }
+
+    int exitCode = 0;
+    if (started == 0) {
+        reportError("Failed to start worker threads\n");
+        exitCode = 1;
+    }
+
+    else {
+        reportStatus("Serving on %s with %d worker%s\n", path, started, started == 1 ? "" : "s");
+        fflush(stdout);
+    }
+
+    struct epoll_event events[64];
+    int running = started > 0;
+    while (running) {
+        int ready = epoll_wait(server.epoll, events, 64, -1);
+        if (ready < 0 && errno != EINTR) {
+            reportError("Failed to wait for connections\n");
+            exitCode = 1;
+            break;
+        }
+
+        for (int e = 0; e < ready; e++) {
+            void *source = events[e].data.ptr;
+            if (source == &server.listener) {
+                serveAccept(&server);
+            }
+
+            else if (source == &server.wake) {
+                serveFinished(&server);
+            }
+
+            else if (source == &server.signals) {
+                // Taking the signal off the queue means it is not delivered again on return
+                struct signalfd_siginfo signal;
+                if (read(server.signals, &signal, sizeof(signal)) == (ssize_t)sizeof(signal)) running = 0;
+            }
+
+            else {
+                ServeConnection *connection = (ServeConnection *)source;
+                int keep = 1;
+                if (connection->closed) {
+                    // Closed earlier in this batch, by serveFinished
+                }
+
+                else if (connection->state == SERVE_WORKING) {
+                    // Only a hang-up is reported now; close once the worker is done
+                    connection->hungUp = 1;
+                    epoll_ctl(server.epoll, EPOLL_CTL_DEL, connection->fd, NULL);
+                }
+
+                else if (connection->state == SERVE_SENDING) {
+                    keep = serveSend(&server, connection);
+                }
+
+                else {
+                    keep = serveReceive(&server, connection);
+                }
+                if (!keep) serveClose(&server, connection);
+            }
+        }
+        serveFreeClosed(&server);
+    }
+
+    // Let the workers finish what they hold, then take everything down
+    pthread_mutex_lock(&server.lock);
+    server.stopping = 1;
+    pthread_cond_broadcast(&server.work);
+    pthread_mutex_unlock(&server.lock);
+    for (int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+
+    while (server.open) {
+        serveClose(&server, server.open);
     }
+    serveFreeClosed(&server);
+    pthread_cond_destroy(&server.work);
+    pthread_mutex_destroy(&server.lock);
+    close(server.listener);
+    close(server.wake);
+    close(server.signals);
+    close(server.epoll);
+    unlink(path);
+    pthread_sigmask(SIG_UNBLOCK, &mask, NULL);
+    return exitCode;
+}
+#else
+int serveRequests(const char *path, int workers) {
+    (void)path;
+    (void)workers;
+    reportError("--serve is only supported on Linux\n");
+    return 1;
 }
+#endif
 
+// Benchmarks and embedders include this file with V2_NO_MAIN defined
+#ifndef V2_NO_MAIN
 // Main function to process multiple .v2 files
 int main(int argc, char *argv[]) {
     if (argc < 2) {
@@ -641,20 +6044,32 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    int transpileJSON = 0;
-    int transpileYAML = 0;
+    TranspileOptions options = { 0, 0, 0, 0, 0, 0, 0, PARSER_MMAP, 0, 0, 0, 0 };
     int loadAndInterpret = 0;
-    int checkDesign = 0;
-    int checkYAML = 0;
+    int watch = 0;
+    int useCache = 0;
+    const char *cachePath = CACHE_DEFAULT_FILE;
+    int threads = 1;
+    int threadsGiven = 0;
     char *loadFilename = NULL;
+    const char *servePath = NULL;
+    const char *statsPath = NULL;
 
-    for (int i = 1; i < argc; ++i) {
+    // Files are collected with the options in effect at their position, then run together
+    TranspileJob *jobs = NULL;
+    size_t jobCount = 0;
+    size_t jobCapacity = 0;
+    int exitCode = -1;
+
+    for (int i = 1; i < argc && exitCode < 0; ++i) {
         if (strcmp(argv[i], "--version") == 0 || strcmp(argv[i], "-v") == 0) {
+            runTranspileJobs(jobs, jobCount, threads);
             printf("%s [v1.0.3]\n", argv[0]);
-            return 0;
+            exitCode = 0;
         }
         
         else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            runTranspileJobs(jobs, jobCount, threads);
             printf("Usage: %s [options] [filename]\n\n", argv[0]);
             printf("Options\n");
             printf("   -h, --help                 Display this information.\n");
@@ -662,33 +6077,173 @@ int main(int argc, char *argv[]) {
             printf("   --author                   Display the author information.\n");
             printf("   --transpiler::json         Transpile to JSON format.\n");
             printf("   --transpiler::yaml         Transpile to YAML format.\n");
+            printf("   --transpiler::msgpack      Transpile to MessagePack (.msgpack).\n");
+            printf("   --transpiler::cbor         Transpile to CBOR (.cbor).\n");
+            printf("   --compact                  Write JSON without whitespace.\n");
             printf("   --checkDesignJSON          Check, fix, and format JSON output.\n");
             printf("   --checkDesignYAML          Check and validate YAML output.\n");
-            printf("   --load [filename]          Load and interpret the .v2 file.\n");
+            printf("   --compile                  Compile to the binary .v2c format.\n");
+            printf("   --stdout, -o -             Write outputs to stdout instead of next to the input.\n");
+            printf("   -                          Read a .v2 or .v2c file from stdin (output goes to stdout).\n");
+            printf("   --load [filename]          Load and interpret the .v2 or .v2c file.\n");
+            printf("   --validate                 Validate the .json/.yaml files that follow.\n");
+            printf("   --parser::mmap             Parse with the single-pass mapped parser (default).\n");
+            printf("   --parser::stdio            Parse line by line with stdio.\n");
+            printf("   --parser::stream           Emit straight from parser events, in flat memory.\n");
+            printf("   --parser::parallel         Split large files between top-level blocks and parse on every CPU.\n");
+            printf("   -j, --jobs [N]             Transpile N files in parallel (0 = one per CPU).\n");
+            printf("   --watch                    Keep running and re-transpile files as they change.\n");
+            printf("   --cache                    Skip files unchanged since the last run (.v2cache).\n");
+            printf("   --cache::file [filename]   Use the given build cache file.\n");
+            printf("   --serve [socket]           Answer transpile requests on a Unix socket.\n");
+            printf("   --stats                    Report time, bytes and memory per phase for each file.\n");
+            printf("   --stats::json [filename]   Also write those measurements as JSON (- for stdout).\n");
             printf("\nFor bug reporting instructions, please see:\n");
             printf("[https://github.com/magayaga/v2]\n");
-            return 0;
+            exitCode = 0;
         }
         
         else if (strcmp(argv[i], "--author") == 0) {
+            runTranspileJobs(jobs, jobCount, threads);
             printf("Copyright (c) 2024-2025 Cyril John Magayaga\n");
-            return 0;
+            exitCode = 0;
         }
         
         else if (strcmp(argv[i], "--transpiler::json") == 0) {
-            transpileJSON = 1;
+            options.transpileJSON = 1;
         }
         
         else if (strcmp(argv[i], "--transpiler::yaml") == 0) {
-            transpileYAML = 1;
+            options.transpileYAML = 1;
+        }
+        
+        else if (strcmp(argv[i], "--transpiler::msgpack") == 0) {
+            options.transpileMsgPack = 1;
+        }
+        
+        else if (strcmp(argv[i], "--transpiler::cbor") == 0) {
+            options.transpileCBOR = 1;
+        }
+        
+        else if (strcmp(argv[i], "--compact") == 0) {
+            options.compactJSON = 1;
         }
         
         else if (strcmp(argv[i], "--checkDesignJSON") == 0) {
-            checkDesign = 1;
+            options.checkDesign = 1;
         }
         
         else if (strcmp(argv[i], "--checkDesignYAML") == 0) {
-            checkYAML = 1;
+            options.checkYAML = 1;
+        }
+        
+        else if (strcmp(argv[i], "--compile") == 0) {
+            options.compile = 1;
+        }
+        
+        else if (strcmp(argv[i], "--stdout") == 0) {
+            options.toStdout = 1;
+        }
+        
+        else if (strcmp(argv[i], "-o") == 0) {
+            if (i + 1 < argc && isStandardStream(argv[i + 1])) {
+                options.toStdout = 1;
+                i++;
+            }
+            
+            else {
+                runTranspileJobs(jobs, jobCount, threads);
+                fprintf(stderr, "Error: -o only accepts - (stdout); other outputs are written next to their input\n");
+                exitCode = 1;
+            }
+        }
+        
+        else if (strcmp(argv[i], "--validate") == 0) {
+            options.validateOnly = 1;
+        }
+        
+        else if (strcmp(argv[i], "--cache") == 0) {
+            useCache = 1;
+        }
+        
+        else if (strcmp(argv[i], "--cache::file") == 0) {
+            if (i + 1 < argc) {
+                useCache = 1;
+                cachePath = argv[++i];
+            }
+            
+            else {
+                runTranspileJobs(jobs, jobCount, threads);
+                fprintf(stderr, "Error: --cache::file option requires a filename\n");
+                exitCode = 1;
+            }
+        }
+        
+        else if (strcmp(argv[i], "--serve") == 0) {
+            if (i + 1 < argc) {
+                servePath = argv[++i];
+            }
+            
+            else {
+                runTranspileJobs(jobs, jobCount, threads);
+                fprintf(stderr, "Error: --serve option requires a socket path\n");
+                exitCode = 1;
+            }
+        }
+        
+        else if (strcmp(argv[i], "--watch") == 0) {
+            watch = 1;
+        }
+        
+        else if (strcmp(argv[i], "--stats") == 0) {
+            options.stats = 1;
+        }
+        
+        else if (strcmp(argv[i], "--stats::json") == 0) {
+            if (i + 1 < argc) {
+                options.stats = 1;
+                statsPath = argv[++i];
+            }
+            
+            else {
+                runTranspileJobs(jobs, jobCount, threads);
+                fprintf(stderr, "Error: --stats::json option requires a filename\n");
+                exitCode = 1;
+            }
+        }
+        
+        else if (strcmp(argv[i], "--parser::mmap") == 0) {
+            options.parser = PARSER_MMAP;
+        }
+        
+        else if (strcmp(argv[i], "--parser::stdio") == 0) {
+            options.parser = PARSER_STDIO;
+        }
+        
+        else if (strcmp(argv[i], "--parser::stream") == 0) {
+            options.parser = PARSER_STREAM;
+        }
+        
+        else if (strcmp(argv[i], "--parser::parallel") == 0) {
+            options.parser = PARSER_PARALLEL;
+        }
+        
+        else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0 ||
+                 (strncmp(argv[i], "-j", 2) == 0 && isdigit((unsigned char)argv[i][2]))) {
+            const char *flag = argv[i];
+            const char *count = flag[1] == 'j' && flag[2] ? flag + 2 : (i + 1 < argc ? argv[++i] : NULL);
+            char *end = NULL;
+            long value = count ? strtol(count, &end, 10) : -1;
+            if (!count || *end != '\0' || value < 0 || value > 4096) {
+                runTranspileJobs(jobs, jobCount, threads);
+                fprintf(stderr, "Error: %s option requires a number of jobs\n", flag[1] == 'j' ? "-j" : "--jobs");
+                exitCode = 1;
+            }
+            
+            else {
+                threads = value == 0 ? onlineCPUs() : (int)value;
+                threadsGiven = 1;
+            }
         }
         
         else if (strcmp(argv[i], "--load") == 0) {
@@ -698,83 +6253,179 @@ int main(int argc, char *argv[]) {
             }
             
             else {
+                runTranspileJobs(jobs, jobCount, threads);
                 fprintf(stderr, "Error: --load option requires a filename\n");
-                return 1;
+                exitCode = 1;
             }
         }
         
         else {
-            ConfigItem *config = parseV2Config(argv[i]);
-            if (!config) {
-                fprintf(stderr, "Failed to parse %s\n", argv[i]);
-                continue;
+            if (jobCount == jobCapacity) {
+                size_t newCapacity = jobCapacity ? jobCapacity * 2 : 16;
+                TranspileJob *grown = (TranspileJob *)realloc(jobs, newCapacity * sizeof(TranspileJob));
+                if (!grown) {
+                    fprintf(stderr, "Memory allocation failed\n");
+                    exitCode = 1;
+                    break;
+                }
+                jobs = grown;
+                jobCapacity = newCapacity;
+            }
+
+            TranspileJob *job = &jobs[jobCount++];
+            job->filename = argv[i];
+            job->options = options;
+            if (isStandardStream(argv[i])) {
+                // Stdin has no name to put an output next to
+                job->options.toStdout = 1;
             }
+            writerInitMemory(&job->report.log);
+            job->cache = NULL;
+            job->cacheEntry.filename = NULL;
+            memset(&job->stats, 0, sizeof(job->stats));
+            job->cacheHit = 0;
+            job->done = 0;
+            job->failed = 0;
+        }
+    }
 
-            char jsonFilename[256];
-            char yamlFilename[256];
+    // --stats reports when the run ends, which watch and server modes never do
+    if (exitCode < 0 && options.stats && (watch || servePath)) {
+        fprintf(stderr, "Error: --stats cannot be combined with %s\n", watch ? "--watch" : "--serve");
+        exitCode = 1;
+    }
 
-            // Serialize to JSON
-            if (transpileJSON) {
-                changeFileExtension(argv[i], jsonFilename, ".json");
-                FILE *jsonFile = fopen(jsonFilename, "w");
-                if (jsonFile) {
-                    serializeJSON(config, jsonFile, 0, checkDesign);
-                    fclose(jsonFile);
-                    printf("Transpiled to JSON: %s\n", jsonFilename);
-                    
-                    // Validate JSON if checkDesign is enabled
-                    if (checkDesign) {
-                        if (checkDesignJSON(jsonFilename)) {
-                            printf("JSON validation passed for %s\n", jsonFilename);
-                        } else {
-                            printf("Warning: JSON validation failed for %s\n", jsonFilename);
-                        }
-                    }
-                }
-                
-                else {
-                    fprintf(stderr, "Failed to open file %s for writing\n", jsonFilename);
-                }
+    // Watch mode does the first pass itself and runs until interrupted
+    if (exitCode < 0 && watch) {
+        for (size_t i = 0; i < jobCount && exitCode < 0; i++) {
+            if (jobs[i].options.toStdout) {
+                fprintf(stderr, "Error: --watch cannot write to stdout or read from stdin\n");
+                exitCode = 1;
             }
+        }
+        if (exitCode < 0) exitCode = watchFiles(jobs, jobCount);
+    }
 
-            // Serialize to YAML
-            if (transpileYAML) {
-                changeFileExtension(argv[i], yamlFilename, ".yaml");
-                FILE *yamlFile = fopen(yamlFilename, "w");
-                if (yamlFile) {
-                    serializeYAML(config, yamlFile, 0);
-                    fclose(yamlFile);
-                    printf("Transpiled to YAML: %s\n", yamlFilename);
-                    
-                    // Validate YAML if checkYAML is enabled
-                    if (checkYAML) {
-                        if (checkDesignYAML(yamlFilename)) {
-                            printf("YAML validation passed for %s\n", yamlFilename);
-                        } else {
-                            printf("Warning: YAML validation failed for %s\n", yamlFilename);
-                        }
-                    }
-                }
-                
-                else {
-                    fprintf(stderr, "Failed to open file %s for writing\n", yamlFilename);
+    // Server mode handles any files given first, then runs until stopped;
+    // without -j it answers on one worker per CPU
+    if (exitCode < 0 && servePath) {
+        runTranspileJobs(jobs, jobCount, threads);
+        exitCode = serveRequests(servePath, threadsGiven ? threads : onlineCPUs());
+    }
+
+    if (exitCode < 0) {
+        BuildCache cache;
+        if (useCache) {
+            loadBuildCache(&cache, cachePath);
+            for (size_t i = 0; i < jobCount; i++) {
+                jobs[i].cache = &cache;
+            }
+        }
+
+        runTranspileJobs(jobs, jobCount, threads);
+        exitCode = 0;
+
+        if (useCache) {
+            size_t hits = 0;
+            size_t misses = 0;
+            FILE *summary = stdout;
+            CacheEntry *updates = (CacheEntry *)malloc((jobCount + 1) * sizeof(CacheEntry));
+            size_t updateCount = 0;
+            for (size_t i = 0; i < jobCount; i++) {
+                // Outputs sent to stdout are not cached, and the summary must stay out of them
+                if (jobs[i].options.toStdout) summary = stderr;
+                if (jobs[i].options.validateOnly || jobs[i].options.toStdout) continue;
+                if (jobs[i].cacheHit) hits++;
+                else misses++;
+
+                if (!jobs[i].cacheEntry.filename) continue;
+                if (updates) updates[updateCount++] = jobs[i].cacheEntry;
+                else free(jobs[i].cacheEntry.filename);
+            }
+            fprintf(summary, "Build cache: %zu hit%s, %zu miss%s\n", hits, hits == 1 ? "" : "s", misses, misses == 1 ? "" : "es");
+            saveBuildCache(&cache, updates, updateCount);
+            free(updates);
+        }
+
+        // Totals over the files that were measured; the tree peak is the largest one
+        TranspileStats total;
+        memset(&total, 0, sizeof(total));
+        int anyToStdout = 0;
+        for (size_t i = 0; i < jobCount; i++) {
+            const TranspileStats *stats = &jobs[i].stats;
+            if (jobs[i].options.toStdout) anyToStdout = 1;
+            if (stats->files == 0) continue;
+            total.parseSeconds += stats->parseSeconds;
+            total.compileSeconds += stats->compileSeconds;
+            total.jsonSeconds += stats->jsonSeconds;
+            total.yamlSeconds += stats->yamlSeconds;
+            total.msgpackSeconds += stats->msgpackSeconds;
+            total.cborSeconds += stats->cborSeconds;
+            total.validateSeconds += stats->validateSeconds;
+            total.bytesRead += stats->bytesRead;
+            total.bytesWritten += stats->bytesWritten;
+            total.nodes += stats->nodes;
+            if (stats->treeBytes > total.treeBytes) total.treeBytes = stats->treeBytes;
+            total.allocations += stats->allocations;
+            total.files++;
+            total.failed += stats->failed;
+        }
+        if (total.files > 0) {
+            char label[64];
+            snprintf(label, sizeof(label), "%zu file%s", total.files, total.files == 1 ? "" : "s");
+            printStats(anyToStdout ? reportError : reportStatus, label, &total);
+        }
+
+        if (statsPath) {
+            FILE *statsFile = isStandardStream(statsPath) ? stdout : fopen(statsPath, "w");
+            OutputWriter out;
+            if (statsFile) {
+                writerInitFile(&out, statsFile);
+                writerPutString(&out, "{\n  \"files\": [");
+                int first = 1;
+                for (size_t i = 0; i < jobCount; i++) {
+                    if (jobs[i].stats.files == 0) continue;
+                    writerPutString(&out, first ? "\n    " : ",\n    ");
+                    writeStatsJSON(&out, jobs[i].filename, &jobs[i].stats);
+                    first = 0;
                 }
+                writerPutString(&out, "\n  ],\n  \"total\": ");
+                writeStatsJSON(&out, NULL, &total);
+                writerPutString(&out, "\n}\n");
+            }
+            if (!statsFile || !writerClose(&out) || (statsFile != stdout && fclose(statsFile) != 0)) {
+                fprintf(stderr, "Failed to write stats to %s\n", statsPath);
+                exitCode = 1;
             }
+        }
 
-            freeConfigItem(config);
+        // Failed --validate checks make the run fail
+        for (size_t i = 0; i < jobCount; i++) {
+            if (jobs[i].failed) exitCode = 1;
         }
-    }
 
-    if (loadAndInterpret && loadFilename) {
-        ConfigItem *config = parseV2Config(loadFilename);
-        if (!config) {
-            fprintf(stderr, "Failed to load %s\n", loadFilename);
-            return 1;
+        if (loadAndInterpret && loadFilename) {
+            ConfigDocument *document = loadV2Document(loadFilename, options.parser == PARSER_STREAM ? PARSER_MMAP : options.parser);
+            if (!document) {
+                fprintf(stderr, "Failed to load %s\n", loadFilename);
+                exitCode = 1;
+            }
+            
+            else {
+                printf("Interpreting %s:\n", loadFilename);
+                if (document->compiled.nodes) {
+                    interpretCompiledConfig(&document->compiled, 0, 0);
+                }
+
+                else {
+                    interpretConfig(document->root, 0);
+                }
+                freeConfigDocument(document);
+            }
         }
-        printf("Interpreting %s:\n", loadFilename);
-        interpretConfig(config, 0);
-        freeConfigItem(config);
     }
 
-    return 0;
+    free(jobs);
+    return exitCode;
 }
+#endif
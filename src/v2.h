@@ -0,0 +1,39 @@
+/*
+ *
+ * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
+ * Embedding API: read values from a .v2 or .v2c file by path, and the
+ * framing used by `v2 --serve`.
+ * Copyright (c) 2024-2025 Cyril John Magayaga
+ * 
+ */
+#ifndef V2_H
+#define V2_H
+
+typedef struct ConfigDocument V2Document;
+
+// Open a .v2 or .v2c file and index every path in it; NULL on failure
+V2Document *v2_open(const char *filename);
+
+// Get the value at a dotted path such as "born.birthPlace", as written in
+// the file (quotes included); NULL for blocks and missing paths
+const char *v2_get(V2Document *document, const char *path);
+
+// Close a document and release everything it owns
+void v2_close(V2Document *document);
+
+// --serve protocol. Requests and replies are frames: a type byte, the body
+// length as 4 bytes big-endian, then the body. A request body is .v2 or .v2c
+// source; the reply body is the output, or an error message. A connection
+// may send any number of requests, and the replies come back in order.
+#define V2_FRAME_HEADER 5
+#define V2_FRAME_MAX (256u * 1024 * 1024)
+
+#define V2_FRAME_JSON 'j'       // request: transpile to JSON
+#define V2_FRAME_YAML 'y'       // request: transpile to YAML
+#define V2_FRAME_MSGPACK 'm'    // request: transpile to MessagePack
+#define V2_FRAME_CBOR 'b'       // request: transpile to CBOR
+#define V2_FRAME_COMPILE 'c'    // request: compile to .v2c
+#define V2_FRAME_OK 'o'         // reply: the output
+#define V2_FRAME_ERROR 'e'      // reply: what went wrong
+
+#endif
@@ -0,0 +1,190 @@
+/*
+ *
+ * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
+ * Client for `v2 --serve`: sends .v2 files over the server's Unix socket
+ * and prints the replies.
+ * Copyright (c) 2024-2025 Cyril John Magayaga
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "v2.h"
+
+// Function to read a whole file ("-" for stdin) into memory
+static char *readSource(const char *filename, size_t *length) {
+    FILE *file = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "rb");
+    if (!file) return NULL;
+
+    char *data = NULL;
+    size_t capacity = 0;
+    *length = 0;
+    for (;;) {
+        if (*length == capacity) {
+            size_t newCapacity = capacity ? capacity * 2 : 65536;
+            char *grown = (char *)realloc(data, newCapacity);
+            if (!grown) {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = grown;
+            capacity = newCapacity;
+        }
+
+        size_t bytesRead = fread(data + *length, 1, capacity - *length, file);
+        if (bytesRead == 0) break;
+        *length += bytesRead;
+    }
+
+    if (data && ferror(file)) {
+        free(data);
+        data = NULL;
+    }
+    if (file != stdin) fclose(file);
+    return data;
+}
+
+// Function to send all of a buffer
+static int sendAll(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return 0;
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return 1;
+}
+
+// Function to receive exactly `length` bytes
+static int receiveAll(int fd, char *data, size_t length) {
+    while (length > 0) {
+        ssize_t received = recv(fd, data, length, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return 0;
+        data += received;
+        length -= (size_t)received;
+    }
+    return 1;
+}
+
+// Function to send one request and print its reply; returns 1 on success,
+// 0 when the server answered with an error and -1 if the connection failed
+static int transpileRemote(int fd, char type, const char *filename) {
+    size_t length;
+    char *source = readSource(filename, &length);
+    if (!source) {
+        fprintf(stderr, "Failed to read %s\n", filename);
+        return 0;
+    }
+    if (length > V2_FRAME_MAX) {
+        fprintf(stderr, "%s is too large to send\n", filename);
+        free(source);
+        return 0;
+    }
+
+    char header[V2_FRAME_HEADER];
+    header[0] = type;
+    header[1] = (char)(length >> 24);
+    header[2] = (char)(length >> 16);
+    header[3] = (char)(length >> 8);
+    header[4] = (char)length;
+    int sent = sendAll(fd, header, sizeof(header)) && sendAll(fd, source, length);
+    free(source);
+    if (!sent || !receiveAll(fd, header, sizeof(header))) return -1;
+
+    const unsigned char *bytes = (const unsigned char *)header;
+    size_t replyLength = ((size_t)bytes[1] << 24) | ((size_t)bytes[2] << 16) | ((size_t)bytes[3] << 8) | bytes[4];
+    char *reply = (char *)malloc(replyLength + 1);
+    if (!reply || !receiveAll(fd, reply, replyLength)) {
+        free(reply);
+        return -1;
+    }
+
+    if (header[0] == V2_FRAME_OK) {
+        fwrite(reply, 1, replyLength, stdout);
+    }
+
+    else {
+        fflush(stdout);
+        fprintf(stderr, "%s: ", filename);
+        fwrite(reply, 1, replyLength, stderr);
+    }
+    free(reply);
+    return header[0] == V2_FRAME_OK;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s socket [--json | --yaml | --msgpack | --cbor | --compile] [filename | -] ...\n", argv[0]);
+        return 1;
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(argv[1]) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", argv[1]);
+        return 1;
+    }
+    strcpy(address.sun_path, argv[1]);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        fprintf(stderr, "Failed to connect to %s\n", argv[1]);
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+
+    // Every file goes over the same connection, in the format chosen before it
+    char type = V2_FRAME_JSON;
+    int exitCode = 0;
+    int sentAny = 0;
+    for (int i = 2; i <= argc; i++) {
+        const char *filename = i < argc ? argv[i] : (sentAny ? NULL : "-");
+        if (!filename) break;
+
+        if (strcmp(filename, "--json") == 0) {
+            type = V2_FRAME_JSON;
+            continue;
+        }
+
+        else if (strcmp(filename, "--yaml") == 0) {
+            type = V2_FRAME_YAML;
+            continue;
+        }
+
+        else if (strcmp(filename, "--msgpack") == 0) {
+            type = V2_FRAME_MSGPACK;
+            continue;
+        }
+
+        else if (strcmp(filename, "--cbor") == 0) {
+            type = V2_FRAME_CBOR;
+            continue;
+        }
+
+        else if (strcmp(filename, "--compile") == 0) {
+            type = V2_FRAME_COMPILE;
+            continue;
+        }
+
+        sentAny = 1;
+        int result = transpileRemote(fd, type, filename);
+        if (result < 0) {
+            fprintf(stderr, "Lost the connection to %s\n", argv[1]);
+            exitCode = 1;
+            break;
+        }
+        if (result == 0) exitCode = 1;
+    }
+
+    close(fd);
+    return exitCode;
+}
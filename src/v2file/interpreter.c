@@ -3,13 +3,25 @@
  * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
  * This is a scripting language.
  * Copyright (c) 2025 Cyril John Magayaga
- * 
+ *
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include "interpreter.h"
 
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern char **environ;
+#endif
+
 void trim(char *str) {
     int len = strlen(str);
     while(len > 0 && (str[len-1] == '\n' || str[len-1] == '\r')) {
@@ -17,13 +29,124 @@ void trim(char *str) {
     }
 }
 
-void parse_line(char *line) {
+static const struct {
+    const char *prefix;
+    size_t length;
+    uint32_t op;
+} commands[] = {
+    { "createfile.system(", 18, OP_CREATE_FILE },
+    { "os.system(", 10, OP_SYSTEM },
+    { "print.system(", 13, OP_PRINT },
+    { "error.system(", 13, OP_ERROR },
+    { "wait.system(", 12, OP_WAIT },
+};
+
+/* Append an argument to the string table; returns its offset, or -1 */
+static long add_string(program *prog, size_t *capacity, const char *str, size_t len) {
+    if (prog->strings_size + len + 1 > *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 256;
+        while (grown < prog->strings_size + len + 1) grown *= 2;
+        char *strings = realloc(prog->strings, grown);
+        if (!strings) return -1;
+        prog->strings = strings;
+        *capacity = grown;
+    }
+    long offset = (long)prog->strings_size;
+    memcpy(prog->strings + offset, str, len);
+    prog->strings[offset + len] = '\0';
+    prog->strings_size += len + 1;
+    return offset;
+}
+
+/*
+ * Turn one line into an instruction. The argument is what follows the
+ * command's "(" up to the next ")", after any ")" right at the start, with
+ * trailing newlines trimmed. Other lines, and commands with an empty
+ * argument, compile to nothing; wait.system() takes no argument. A
+ * "#v2/parallel N" line lets the script's commands run N at a time.
+ */
+static int compile_line(program *prog, size_t *capacity, char *line) {
     trim(line);
 
-    if (strncmp(line, "createfile.system(", 18) == 0) {
-        char *arg = strtok(line + 18, ")");
-        if (arg) {
-            trim(arg);
+    if (strncmp(line, "#v2/parallel", 12) == 0 && (line[12] == '\0' || line[12] == ' ')) {
+        long jobs = strtol(line + 12, NULL, 10);
+        prog->jobs = jobs > 0 ? (uint32_t)jobs : JOBS_PER_CPU;
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        if (strncmp(line, commands[i].prefix, commands[i].length) != 0) continue;
+
+        char *arg = line + commands[i].length + strspn(line + commands[i].length, ")");
+        if (*arg == '\0' && commands[i].op != OP_WAIT) return 1;
+        char *end = strchr(arg, ')');
+        if (end) *end = '\0';
+        trim(arg);
+
+        long offset = add_string(prog, capacity, arg, strlen(arg));
+        if (offset < 0) return 0;
+        prog->code[prog->count].op = commands[i].op;
+        prog->code[prog->count].arg = (uint32_t)offset;
+        prog->count++;
+        return 1;
+    }
+    return 1;
+}
+
+/* Compile a whole script once, so it can be run any number of times */
+int compile_script(const char *code, program *prog) {
+    prog->code = NULL;
+    prog->count = 0;
+    prog->strings = NULL;
+    prog->strings_size = 0;
+    prog->jobs = 0;
+
+    /* At most one instruction per line */
+    size_t lines = 1;
+    for (const char *p = code; *p; p++) {
+        if (*p == '\n') lines++;
+    }
+
+    char *copy = strdup(code);
+    prog->code = malloc(lines * sizeof(instruction));
+    size_t capacity = 0;
+    int ok = copy && prog->code;
+
+    char *line = copy;
+    while (ok && line && *line) {
+        char *next = strchr(line, '\n');
+        if (next) *next++ = '\0';
+        if (*line) ok = compile_line(prog, &capacity, line);
+        line = next;
+    }
+
+    free(copy);
+    if (!ok) {
+        fprintf(stderr, "Memory allocation failed\n");
+        free_program(prog);
+    }
+    return ok;
+}
+
+/* Turn what system() returned into an exit code, or 128 + the signal that killed the command */
+static int system_status(int status) {
+#ifndef _WIN32
+    if (status == -1) return 127;
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 0;
+#else
+    return status;
+#endif
+}
+
+/* Run a program; returns 0, or the exit code of the first command that failed */
+int run_program(const program *prog) {
+    int failed = 0;
+    for (size_t i = 0; i < prog->count; i++) {
+        const char *arg = prog->strings + prog->code[i].arg;
+
+        switch (prog->code[i].op) {
+        case OP_CREATE_FILE: {
             FILE *f = fopen(arg, "w");
             if (f) {
                 fclose(f);
@@ -31,36 +154,612 @@ void parse_line(char *line) {
             } else {
                 fprintf(stderr, "Failed to create file: %s\n", arg);
             }
+            break;
         }
-    } else if (strncmp(line, "os.system(", 10) == 0) {
-        char *arg = strtok(line + 10, ")");
-        if (arg) {
-            trim(arg);
-            system(arg);
+        case OP_SYSTEM: {
+            /* Keep earlier output ahead of the command's */
+            fflush(stdout);
+            int status = system_status(system(arg));
+            if (status != 0 && failed == 0) failed = status;
+            break;
         }
-    } else if (strncmp(line, "print.system(", 13) == 0) {
-        char *arg = strtok(line + 13, ")");
-        if (arg) {
-            trim(arg);
+        case OP_PRINT:
             printf("%s\n", arg);
-        }
-    } else if (strncmp(line, "error.system(", 13) == 0) {
-        char *arg = strtok(line + 13, ")");
-        if (arg) {
-            trim(arg);
+            break;
+        case OP_ERROR:
             fprintf(stderr, "%s\n", arg);
+            break;
+        case OP_WAIT:
+            /* Every command has finished already */
+            break;
+        }
+    }
+    return failed;
+}
+
+#ifndef _WIN32
+/*
+ * Batched execution. Output from print.system, error.system and file
+ * creation is gathered in one buffer and written in large blocks. The
+ * buffer is flushed whenever the target switches between stdout and
+ * stderr, and before a command runs, so everything still comes out in
+ * script order. Files are created with a bare open/close, without a stdio
+ * stream. Commands are started with posix_spawnp, without a shell; a
+ * command that uses shell syntax, or that cannot be started directly,
+ * runs through /bin/sh -c. Unlike system(), SIGINT and SIGQUIT are not
+ * ignored while a command runs, so Ctrl-C stops v2file along with it.
+ */
+#define BATCH_BUFFER_SIZE (64 * 1024)
+#define BATCH_MAX_RUNNING 64
+
+typedef struct {
+    int fd;
+    size_t length;
+    char data[BATCH_BUFFER_SIZE];
+} batch_output;
+
+/* Write all of text to fd, going on after partial writes and signals */
+static void write_all(int fd, const char *text, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t written = write(fd, text + done, len - done);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) break;
+        done += (size_t)written;
+    }
+}
+
+static void batch_flush(batch_output *out) {
+    write_all(out->fd, out->data, out->length);
+    out->length = 0;
+}
+
+static void batch_write(batch_output *out, int fd, const char *text, size_t len) {
+    if (out->fd != fd) {
+        batch_flush(out);
+        out->fd = fd;
+    }
+    if (out->length + len > sizeof(out->data)) {
+        batch_flush(out);
+        if (len > sizeof(out->data)) {
+            /* Too big for the buffer: write it straight out */
+            write_all(fd, text, len);
+            return;
+        }
+    }
+    memcpy(out->data + out->length, text, len);
+    out->length += len;
+}
+
+/* Write text, "text", or "before<text>after" in the buffer */
+static void batch_line(batch_output *out, int fd, const char *before, const char *text) {
+    if (before) batch_write(out, fd, before, strlen(before));
+    batch_write(out, fd, text, strlen(text));
+    batch_write(out, fd, "\n", 1);
+}
+
+/* Whether a command uses quoting, expansion, redirection or other shell syntax */
+static int needs_shell(const char *command) {
+    return strpbrk(command, "|&;<>()$`\\\"'*?[]#~=%{}!\n") != NULL;
+}
+
+/* Start a command, with its output redirected by actions if given; returns its pid, or -1 */
+static pid_t batch_spawn(const char *command, const posix_spawn_file_actions_t *actions) {
+    pid_t pid;
+    if (!needs_shell(command)) {
+        /* Plain words: split on blanks and run the program itself */
+        char *copy = strdup(command);
+        size_t words = 0;
+        char **argv = copy ? malloc((strlen(command) / 2 + 2) * sizeof(char *)) : NULL;
+        int started = 0;
+        if (argv) {
+            for (char *word = strtok(copy, " \t"); word; word = strtok(NULL, " \t")) {
+                argv[words++] = word;
+            }
+            argv[words] = NULL;
+            started = words > 0 && posix_spawnp(&pid, argv[0], actions, NULL, argv, environ) == 0;
+        }
+        free(argv);
+        free(copy);
+        if (started) return pid;
+    }
+
+    char *argv[] = { "sh", "-c", (char *)command, NULL };
+    if (posix_spawn(&pid, "/bin/sh", actions, NULL, argv, environ) != 0) return -1;
+    return pid;
+}
+
+/* Wait for a command; returns its exit code, or 128 + the signal that killed it */
+static int batch_wait(pid_t pid) {
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return 127;
+    }
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 0;
+}
+
+/* Keep the exit code of the first command that failed */
+static void batch_note(int *failed, int status) {
+    if (status != 0 && *failed == 0) *failed = status;
+}
+
+/*
+ * Run a program in batched mode. Sequentially, each command finishes before
+ * the next line runs. Pipelined, commands are started without waiting (at
+ * most BATCH_MAX_RUNNING at a time) and all are waited for at the end, so
+ * their output may interleave. Returns 0, or the exit code of the first
+ * command, in script order, that failed.
+ */
+int run_program_batched(const program *prog, int pipelined) {
+    static batch_output out;
+    out.fd = STDOUT_FILENO;
+    out.length = 0;
+    pid_t running[BATCH_MAX_RUNNING];
+    size_t oldest = 0;
+    size_t count = 0;
+    int failed = 0;
+
+    fflush(stdout);
+    fflush(stderr);
+    for (size_t i = 0; i < prog->count; i++) {
+        const char *arg = prog->strings + prog->code[i].arg;
+
+        switch (prog->code[i].op) {
+        case OP_CREATE_FILE: {
+            int fd;
+            do {
+                fd = open(arg, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+            } while (fd < 0 && errno == EINTR);
+            if (fd >= 0) {
+                close(fd);
+                batch_line(&out, STDOUT_FILENO, "File created: ", arg);
+            } else {
+                batch_line(&out, STDERR_FILENO, "Failed to create file: ", arg);
+            }
+            break;
+        }
+        case OP_SYSTEM: {
+            batch_flush(&out);
+            if (pipelined && count == BATCH_MAX_RUNNING) {
+                batch_note(&failed, batch_wait(running[oldest]));
+                oldest = (oldest + 1) % BATCH_MAX_RUNNING;
+                count--;
+            }
+            pid_t pid = batch_spawn(arg, NULL);
+            if (pid < 0) {
+                batch_note(&failed, 127);
+                break;
+            }
+            if (pipelined) {
+                running[(oldest + count) % BATCH_MAX_RUNNING] = pid;
+                count++;
+            } else {
+                batch_note(&failed, batch_wait(pid));
+            }
+            break;
+        }
+        case OP_PRINT:
+            batch_line(&out, STDOUT_FILENO, NULL, arg);
+            break;
+        case OP_ERROR:
+            batch_line(&out, STDERR_FILENO, NULL, arg);
+            break;
+        case OP_WAIT:
+            batch_flush(&out);
+            while (count > 0) {
+                batch_note(&failed, batch_wait(running[oldest]));
+                oldest = (oldest + 1) % BATCH_MAX_RUNNING;
+                count--;
+            }
+            break;
+        }
+    }
+
+    batch_flush(&out);
+    while (count > 0) {
+        batch_note(&failed, batch_wait(running[oldest]));
+        oldest = (oldest + 1) % BATCH_MAX_RUNNING;
+        count--;
+    }
+    return failed;
+}
+
+/*
+ * Parallel execution. Commands run up to `jobs` at a time, and the script
+ * goes on past each one until a wait.system() line (or its end) waits for
+ * all of them. Each command's stdout and stderr are captured through pipes,
+ * and everything the script prints is queued behind the commands before
+ * it, then written in script order as soon as everything ahead of it is
+ * done. Captured output keeps its stream and the order it arrived in.
+ */
+typedef struct parallel_entry {
+    int command;            /* 0 for lines the script printed itself */
+    pid_t pid;
+    int fds[2];             /* stdout and stderr pipes, -1 once at EOF */
+    int done;
+    int status;
+    char *data;             /* records: stream fd, length, bytes */
+    size_t length;
+    size_t capacity;
+    struct parallel_entry *next;
+} parallel_entry;
+
+typedef struct {
+    parallel_entry *head;
+    parallel_entry *tail;
+    size_t running;
+    int status;             /* exit code of the first command that failed */
+    batch_output out;
+} parallel_state;
+
+static int entry_record(parallel_entry *entry, int fd, const char *text, size_t len) {
+    size_t needed = entry->length + 1 + sizeof(size_t) + len;
+    if (needed > entry->capacity) {
+        size_t grown = entry->capacity ? entry->capacity * 2 : 256;
+        while (grown < needed) grown *= 2;
+        char *data = realloc(entry->data, grown);
+        if (!data) return 0;
+        entry->data = data;
+        entry->capacity = grown;
+    }
+    entry->data[entry->length] = (char)fd;
+    memcpy(entry->data + entry->length + 1, &len, sizeof(size_t));
+    memcpy(entry->data + entry->length + 1 + sizeof(size_t), text, len);
+    entry->length = needed;
+    return 1;
+}
+
+static parallel_entry *parallel_append(parallel_state *state) {
+    parallel_entry *entry = calloc(1, sizeof(parallel_entry));
+    if (!entry) return NULL;
+    entry->fds[0] = -1;
+    entry->fds[1] = -1;
+    if (state->tail) {
+        state->tail->next = entry;
+    } else {
+        state->head = entry;
+    }
+    state->tail = entry;
+    return entry;
+}
+
+/* Queue a line the script prints itself, behind everything still running */
+static void parallel_line(parallel_state *state, int fd, const char *before, const char *text) {
+    parallel_entry *entry = state->tail;
+    if (!entry || entry->command) entry = parallel_append(state);
+    if (!entry) return;
+    entry->done = 1;
+    int ok = (!before || entry_record(entry, fd, before, strlen(before))) &&
+             entry_record(entry, fd, text, strlen(text)) &&
+             entry_record(entry, fd, "\n", 1);
+    if (!ok) fprintf(stderr, "Memory allocation failed\n");
+}
+
+/* Write out every finished entry at the front of the queue */
+static void parallel_emit(parallel_state *state) {
+    while (state->head && state->head->done) {
+        parallel_entry *entry = state->head;
+        size_t pos = 0;
+        while (pos < entry->length) {
+            size_t len;
+            memcpy(&len, entry->data + pos + 1, sizeof(size_t));
+            batch_write(&state->out, (unsigned char)entry->data[pos], entry->data + pos + 1 + sizeof(size_t), len);
+            pos += 1 + sizeof(size_t) + len;
+        }
+        if (entry->command && entry->status != 0 && state->status == 0) state->status = entry->status;
+        state->head = entry->next;
+        if (!state->head) state->tail = NULL;
+        free(entry->data);
+        free(entry);
+    }
+    batch_flush(&state->out);
+}
+
+/* Read whatever the running commands have written, and reap the ones that closed their output */
+static void parallel_pump(parallel_state *state) {
+    struct pollfd fds[2 * BATCH_MAX_RUNNING];
+    parallel_entry *owners[2 * BATCH_MAX_RUNNING];
+    int streams[2 * BATCH_MAX_RUNNING];
+    nfds_t count = 0;
+    for (parallel_entry *entry = state->head; entry && count < 2 * BATCH_MAX_RUNNING; entry = entry->next) {
+        for (int stream = 0; stream < 2 && !entry->done; stream++) {
+            if (entry->fds[stream] < 0) continue;
+            fds[count].fd = entry->fds[stream];
+            fds[count].events = POLLIN;
+            owners[count] = entry;
+            streams[count] = stream;
+            count++;
         }
     }
+    if (count == 0) return;
+    if (poll(fds, count, -1) < 0) return;
+
+    char buffer[16384];
+    for (nfds_t i = 0; i < count; i++) {
+        if (!fds[i].revents) continue;
+        parallel_entry *entry = owners[i];
+        int stream = streams[i];
+        ssize_t got = read(entry->fds[stream], buffer, sizeof(buffer));
+        if (got < 0 && errno == EINTR) continue;
+        if (got > 0) {
+            if (!entry_record(entry, stream ? STDERR_FILENO : STDOUT_FILENO, buffer, (size_t)got)) {
+                fprintf(stderr, "Memory allocation failed\n");
+            }
+            continue;
+        }
+        close(entry->fds[stream]);
+        entry->fds[stream] = -1;
+        if (entry->fds[0] < 0 && entry->fds[1] < 0) {
+            entry->status = batch_wait(entry->pid);
+            entry->done = 1;
+            state->running--;
+        }
+    }
+}
+
+/* Start a command with its output captured, and queue it */
+static void parallel_start(parallel_state *state, const char *command) {
+    int out[2], err[2];
+    parallel_entry *entry = parallel_append(state);
+    if (!entry) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return;
+    }
+    entry->command = 1;
+    if (pipe(out) != 0) {
+        entry->done = 1;
+        entry->status = 127;
+        return;
+    }
+    if (pipe(err) != 0) {
+        close(out[0]);
+        close(out[1]);
+        entry->done = 1;
+        entry->status = 127;
+        return;
+    }
+    fcntl(out[0], F_SETFD, FD_CLOEXEC);
+    fcntl(err[0], F_SETFD, FD_CLOEXEC);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, err[1], STDERR_FILENO);
+    posix_spawn_file_actions_addclose(&actions, out[1]);
+    posix_spawn_file_actions_addclose(&actions, err[1]);
+    pid_t pid = batch_spawn(command, &actions);
+    posix_spawn_file_actions_destroy(&actions);
+    close(out[1]);
+    close(err[1]);
+
+    if (pid < 0) {
+        close(out[0]);
+        close(err[0]);
+        entry->done = 1;
+        entry->status = 127;
+        return;
+    }
+    entry->pid = pid;
+    entry->fds[0] = out[0];
+    entry->fds[1] = err[0];
+    state->running++;
+}
+
+/* Wait for every running command, writing output as it becomes ready */
+static void parallel_barrier(parallel_state *state) {
+    while (state->running > 0) {
+        parallel_pump(state);
+        parallel_emit(state);
+    }
+    parallel_emit(state);
+}
+
+/*
+ * Run a program with up to `jobs` commands at a time (JOBS_PER_CPU for one
+ * per CPU). Returns 0 when every command succeeded, or else the exit code
+ * of the first one, in script order, that did not.
+ */
+int run_program_parallel(const program *prog, uint32_t jobs) {
+    if (jobs == JOBS_PER_CPU) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cpus > 0 ? (uint32_t)cpus : 1;
+    }
+    if (jobs < 1) jobs = 1;
+    if (jobs > BATCH_MAX_RUNNING) jobs = BATCH_MAX_RUNNING;
+
+    static parallel_state state;
+    memset(&state, 0, sizeof(state));
+    state.out.fd = STDOUT_FILENO;
+    fflush(stdout);
+    fflush(stderr);
+
+    for (size_t i = 0; i < prog->count; i++) {
+        const char *arg = prog->strings + prog->code[i].arg;
+
+        switch (prog->code[i].op) {
+        case OP_CREATE_FILE: {
+            int fd;
+            do {
+                fd = open(arg, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+            } while (fd < 0 && errno == EINTR);
+            if (fd >= 0) {
+                close(fd);
+                parallel_line(&state, STDOUT_FILENO, "File created: ", arg);
+            } else {
+                parallel_line(&state, STDERR_FILENO, "Failed to create file: ", arg);
+            }
+            break;
+        }
+        case OP_SYSTEM:
+            while (state.running >= jobs) {
+                parallel_pump(&state);
+                parallel_emit(&state);
+            }
+            parallel_start(&state, arg);
+            break;
+        case OP_PRINT:
+            parallel_line(&state, STDOUT_FILENO, NULL, arg);
+            break;
+        case OP_ERROR:
+            parallel_line(&state, STDERR_FILENO, NULL, arg);
+            break;
+        case OP_WAIT:
+            parallel_barrier(&state);
+            break;
+        }
+        parallel_emit(&state);
+    }
+
+    parallel_barrier(&state);
+    return state.status;
+}
+#else
+int run_program_batched(const program *prog, int pipelined) {
+    (void)pipelined;
+    return run_program(prog);
+}
+
+int run_program_parallel(const program *prog, uint32_t jobs) {
+    (void)jobs;
+    return run_program(prog);
+}
+#endif
+
+void free_program(program *prog) {
+    free(prog->code);
+    free(prog->strings);
+    prog->code = NULL;
+    prog->count = 0;
+    prog->strings = NULL;
+    prog->strings_size = 0;
+    prog->jobs = 0;
 }
 
 void interpret(const char *code) {
-    char *copy = strdup(code);
-    char *line = strtok(copy, "\n");
+    program prog;
+    if (compile_script(code, &prog)) {
+        run_program(&prog);
+        free_program(&prog);
+    }
+}
 
-    while (line) {
-        parse_line(line);
-        line = strtok(NULL, "\n");
+/*
+ * Compiled scripts on disk: a header, the instructions, then the string
+ * table. The script's size and modification time are stored with them, so
+ * an edited script is compiled again instead of loaded, and a checksum of
+ * the rest, so a damaged file is never run.
+ */
+#define CACHE_MAGIC "V2FC"
+#define CACHE_VERSION 2
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t script_size;
+    int64_t script_seconds;
+    int64_t script_nanoseconds;
+    uint32_t count;
+    uint32_t strings_size;
+    uint32_t jobs;
+    uint32_t reserved;
+    uint64_t checksum;
+} cache_header;
+
+/* FNV-1a over the job count, the instructions and the string table */
+static uint64_t program_checksum(const program *prog) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int shift = 0; shift < 32; shift += 8) {
+        hash = (hash ^ ((prog->jobs >> shift) & 0xff)) * 1099511628211ULL;
+    }
+    const unsigned char *bytes = (const unsigned char *)prog->code;
+    for (size_t i = 0; i < prog->count * sizeof(instruction); i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    bytes = (const unsigned char *)prog->strings;
+    for (size_t i = 0; i < prog->strings_size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
     }
+    return hash;
+}
 
-    free(copy);
+static int script_stamp(const char *script, cache_header *header) {
+    struct stat info;
+    if (stat(script, &info) != 0) return 0;
+    memcpy(header->magic, CACHE_MAGIC, 4);
+    header->version = CACHE_VERSION;
+    header->script_size = (uint64_t)info.st_size;
+    header->script_seconds = (int64_t)info.st_mtime;
+#if defined(__linux__)
+    header->script_nanoseconds = (int64_t)info.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    header->script_nanoseconds = (int64_t)info.st_mtimespec.tv_nsec;
+#else
+    header->script_nanoseconds = 0;
+#endif
+    return 1;
+}
+
+int save_program(const program *prog, const char *path, const char *script) {
+    cache_header header;
+    memset(&header, 0, sizeof(header));
+    if (!script_stamp(script, &header) || prog->count > UINT32_MAX || prog->strings_size > UINT32_MAX) return 0;
+    header.count = (uint32_t)prog->count;
+    header.strings_size = (uint32_t)prog->strings_size;
+    header.jobs = prog->jobs;
+    header.checksum = program_checksum(prog);
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return 0;
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+             fwrite(prog->code, sizeof(instruction), prog->count, f) == prog->count &&
+             fwrite(prog->strings, 1, prog->strings_size, f) == prog->strings_size;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) remove(path);
+    return ok;
+}
+
+/* Load a compiled script; fails if it is missing, damaged, or older than the script */
+int load_program(program *prog, const char *path, const char *script) {
+    prog->code = NULL;
+    prog->count = 0;
+    prog->strings = NULL;
+    prog->strings_size = 0;
+    prog->jobs = 0;
+
+    cache_header expected, header;
+    memset(&expected, 0, sizeof(expected));
+    if (!script_stamp(script, &expected)) return 0;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    int ok = fread(&header, sizeof(header), 1, f) == 1 &&
+             memcmp(header.magic, expected.magic, 4) == 0 &&
+             header.version == expected.version &&
+             header.script_size == expected.script_size &&
+             header.script_seconds == expected.script_seconds &&
+             header.script_nanoseconds == expected.script_nanoseconds;
+
+    if (ok) {
+        prog->count = header.count;
+        prog->strings_size = header.strings_size;
+        prog->jobs = header.jobs;
+        prog->code = malloc(prog->count ? prog->count * sizeof(instruction) : 1);
+        prog->strings = malloc(prog->strings_size ? prog->strings_size : 1);
+        ok = prog->code && prog->strings &&
+             fread(prog->code, sizeof(instruction), prog->count, f) == prog->count &&
+             fread(prog->strings, 1, prog->strings_size, f) == prog->strings_size &&
+             fgetc(f) == EOF &&
+             program_checksum(prog) == header.checksum;
+    }
+    fclose(f);
+
+    /* Every argument must start inside the table, which must end in a NUL */
+    if (ok && prog->count > 0 && (prog->strings_size == 0 || prog->strings[prog->strings_size - 1] != '\0')) ok = 0;
+    for (size_t i = 0; ok && i < prog->count; i++) {
+        if (prog->code[i].op >= OP_COUNT || prog->code[i].arg >= prog->strings_size) ok = 0;
+    }
+
+    if (!ok) free_program(prog);
+    return ok;
 }
@@ -3,11 +3,50 @@
  * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
  * This is a scripting language.
  * Copyright (c) 2025 Cyril John Magayaga
- * 
+ *
  */
 #ifndef INTERPRETER_H
 #define INTERPRETER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+    OP_CREATE_FILE,
+    OP_SYSTEM,
+    OP_PRINT,
+    OP_ERROR,
+    OP_WAIT,
+    OP_COUNT
+};
+
+/* program.jobs for "#v2/parallel" without a count: one job per CPU */
+#define JOBS_PER_CPU UINT32_MAX
+
+/* One command, with its argument already cut out of the line */
+typedef struct {
+    uint32_t op;
+    uint32_t arg;       /* offset of the NUL-terminated argument in strings */
+} instruction;
+
+/* A compiled script: instructions in order and the arguments they point into */
+typedef struct {
+    instruction *code;
+    size_t count;
+    char *strings;
+    size_t strings_size;
+    uint32_t jobs;      /* from "#v2/parallel N"; 0 runs commands one by one */
+} program;
+
 void interpret(const char *code);
 
+int compile_script(const char *code, program *prog);
+int run_program(const program *prog);
+int run_program_batched(const program *prog, int pipelined);
+int run_program_parallel(const program *prog, uint32_t jobs);
+void free_program(program *prog);
+
+int save_program(const program *prog, const char *path, const char *script);
+int load_program(program *prog, const char *path, const char *script);
+
 #endif
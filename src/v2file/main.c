@@ -3,22 +3,18 @@
  * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
  * This is a scripting language.
  * Copyright (c) 2025 Cyril John Magayaga
- * 
+ *
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "interpreter.h"
 
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <script.v2f>\n", argv[0]);
-        return 1;
-    }
-
-    FILE *fp = fopen(argv[1], "r");
+static char *read_script(const char *path) {
+    FILE *fp = fopen(path, "r");
     if (!fp) {
         perror("Error opening file");
-        return 1;
+        return NULL;
     }
 
     fseek(fp, 0, SEEK_END);
@@ -26,11 +22,96 @@ int main(int argc, char *argv[]) {
     rewind(fp);
 
     char *code = malloc(size + 1);
-    fread(code, 1, size, fp);
-    code[size] = '\0';
+    if (!code) {
+        fclose(fp);
+        fprintf(stderr, "Memory allocation failed\n");
+        return NULL;
+    }
+    size_t length = fread(code, 1, size, fp);
+    code[length] = '\0';
     fclose(fp);
+    return code;
+}
+
+int main(int argc, char *argv[]) {
+    int use_cache = 0;
+    int batched = 0;
+    int pipelined = 0;
+    long jobs = -1;
+    const char *script = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cache") == 0) {
+            use_cache = 1;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batched = 1;
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            batched = 1;
+            pipelined = 1;
+        } else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) {
+            const char *option = argv[i];
+            char *end = NULL;
+            if (i + 1 < argc) jobs = strtol(argv[++i], &end, 10);
+            if (!end || end == argv[i] || *end != '\0' || jobs < 0) {
+                fprintf(stderr, "%s needs a job count of 0 or more\n", option);
+                return 1;
+            }
+        } else {
+            script = argv[i];
+        }
+    }
 
-    interpret(code);
-    free(code);
-    return 0;
+    if (!script) {
+        fprintf(stderr, "Usage: %s [--cache] [--batch | --pipeline | -j N] <script.v2f>\n", argv[0]);
+        return 1;
+    }
+
+    /* Parallel runs capture each command's output, so they cannot also be batched */
+    if (jobs >= 0 && batched) {
+        fprintf(stderr, "-j cannot be combined with %s\n", pipelined ? "--pipeline" : "--batch");
+        return 1;
+    }
+
+    /* With --cache the compiled script is kept next to it, as <script>c */
+    program prog;
+    char *cache_path = NULL;
+    if (use_cache) {
+        cache_path = malloc(strlen(script) + 2);
+        if (cache_path) {
+            strcpy(cache_path, script);
+            strcat(cache_path, "c");
+        }
+    }
+
+    if (!cache_path || !load_program(&prog, cache_path, script)) {
+        char *code = read_script(script);
+        if (!code) {
+            free(cache_path);
+            return 1;
+        }
+        int compiled = compile_script(code, &prog);
+        free(code);
+        if (!compiled) {
+            free(cache_path);
+            return 1;
+        }
+        if (cache_path && !save_program(&prog, cache_path, script)) {
+            fprintf(stderr, "Failed to write %s\n", cache_path);
+        }
+    }
+
+    /* -j N overrides the script's "#v2/parallel N"; -j 0 means one per CPU */
+    int status = 0;
+    uint32_t parallel = prog.jobs;
+    if (jobs >= 0) parallel = jobs == 0 ? JOBS_PER_CPU : (uint32_t)jobs;
+    if (parallel > 1) {
+        status = run_program_parallel(&prog, parallel);
+    } else if (batched) {
+        status = run_program_batched(&prog, pipelined);
+    } else {
+        status = run_program(&prog);
+    }
+    free_program(&prog);
+    free(cache_path);
+    return status;
 }
@@ -0,0 +1,75 @@
+/*
+ *
+ * V2, ALSO KNOWN AS "VALENCIA-VILLAMER"
+ * v2file: a printed line longer than the 64 KB batch buffer comes out
+ * whole and unchanged, batched, pipelined and in parallel.
+ * Copyright (c) 2024-2025 Cyril John Magayaga
+ *
+ */
+#include "../src/v2file/interpreter.c"
+
+#include <unistd.h>
+
+#define LINE_LENGTH 70000
+
+// Run the program with stdout sent to a temporary file; returns what it wrote
+static char *capture(const program *prog, int mode, size_t *length) {
+    char path[] = "/tmp/v2_long_line_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return NULL;
+    unlink(path);
+
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    if (mode == 0) run_program_batched(prog, 0);
+    else if (mode == 1) run_program_batched(prog, 1);
+    else run_program_parallel(prog, 4);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    off_t size = lseek(fd, 0, SEEK_END);
+    char *text = malloc((size_t)size + 1);
+    if (text && pread(fd, text, (size_t)size, 0) != (ssize_t)size) {
+        free(text);
+        text = NULL;
+    }
+    close(fd);
+    if (text) text[size] = '\0';
+    *length = (size_t)size;
+    return text;
+}
+
+int main(void) {
+    // A short line, the long one, then another short one
+    char *code = malloc(LINE_LENGTH + 64);
+    size_t length = (size_t)sprintf(code, "print.system(first)\nprint.system(");
+    for (size_t i = 0; i < LINE_LENGTH; i++) code[length++] = (char)('a' + i % 26);
+    length += (size_t)sprintf(code + length, ")\nprint.system(last)\n");
+
+    char *expected = malloc(LINE_LENGTH + 16);
+    size_t expectedLength = (size_t)sprintf(expected, "first\n");
+    memcpy(expected + expectedLength, code + 33, LINE_LENGTH);
+    expectedLength += LINE_LENGTH;
+    expectedLength += (size_t)sprintf(expected + expectedLength, "\nlast\n");
+
+    program prog;
+    if (!compile_script(code, &prog)) return 1;
+
+    static const char *modes[] = { "batched", "pipelined", "parallel" };
+    int failed = 0;
+    for (int mode = 0; mode < 3; mode++) {
+        size_t got = 0;
+        char *output = capture(&prog, mode, &got);
+        int ok = output && got == expectedLength && memcmp(output, expected, got) == 0;
+        printf("%-10s %s\n", modes[mode], ok ? "ok" : "FAILED");
+        if (!ok) failed = 1;
+        free(output);
+    }
+
+    free_program(&prog);
+    free(expected);
+    free(code);
+    return failed;
+}